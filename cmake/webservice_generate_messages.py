@@ -0,0 +1,388 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Copyright (c) 2018 Benjamin Buch
+#
+# https://github.com/bebuch/webservice
+#
+# Distributed under the Boost Software License, Version 1.0. (See accompanying
+# file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+#-----------------------------------------------------------------------------
+"""Generate fixed layout message views and builders for webservice.
+
+Usage: webservice_generate_messages.py <input.wsm> <output.hpp>
+
+A message definition file contains an optional namespace and messages:
+
+    // comment
+    namespace example::sensors;
+
+    message sensor_update{
+        uint32 id;
+        float64 value;
+        bool valid;
+        uint16[4] channels;
+        char[16] name;
+    }
+
+Field types are int8, uint8, int16, uint16, int32, uint32, int64, uint64,
+float32, float64 and bool. Every type except bool can be used as array with
+a fixed element count, char can only be used as array. Fields are stored
+in declaration order without padding, all values little endian.
+"""
+
+import os
+import re
+import sys
+
+
+TYPES = {
+    "int8": ("std::int8_t", 1),
+    "uint8": ("std::uint8_t", 1),
+    "int16": ("std::int16_t", 2),
+    "uint16": ("std::uint16_t", 2),
+    "int32": ("std::int32_t", 4),
+    "uint32": ("std::uint32_t", 4),
+    "int64": ("std::int64_t", 8),
+    "uint64": ("std::uint64_t", 8),
+    "float32": ("float", 4),
+    "float64": ("double", 8),
+    "bool": ("bool", 1),
+    "char": (None, 1),
+}
+
+# members of the generated classes and their bases
+RESERVED = {"view", "builder", "data", "load", "load_text", "store",
+    "store_text", "freeze", "wire_size"}
+
+# C++ keywords that look like field names
+KEYWORDS = {"alignas", "alignof", "and", "asm", "auto", "bool", "break",
+    "case", "catch", "char", "class", "const", "constexpr", "continue",
+    "default", "delete", "do", "double", "else", "enum", "explicit", "export",
+    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int",
+    "long", "mutable", "namespace", "new", "noexcept", "not", "nullptr",
+    "operator", "or", "private", "protected", "public", "register", "return",
+    "short", "signed", "sizeof", "static", "struct", "switch", "template",
+    "this", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+    "unsigned", "using", "virtual", "void", "volatile", "while", "xor"}
+
+IDENTIFIER = r"[A-Za-z_][A-Za-z0-9_]*"
+
+TOKEN = re.compile(r"\s*(?:(//[^\n]*)|(" + IDENTIFIER + r"(?:::"
+    + IDENTIFIER + r")*)|([0-9]+)|([{}\[\];]))")
+
+
+class Error(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, type_name, count, name, offset):
+        self.type_name = type_name
+        self.count = count
+        self.name = name
+        self.offset = offset
+
+    @property
+    def cpp_type(self):
+        return TYPES[self.type_name][0]
+
+    @property
+    def element_size(self):
+        return TYPES[self.type_name][1]
+
+    @property
+    def size(self):
+        return self.element_size * (self.count or 1)
+
+
+class Message:
+    def __init__(self, name):
+        self.name = name
+        self.fields = []
+        self.size = 0
+
+    def add(self, type_name, count, name):
+        if name in RESERVED or name in KEYWORDS:
+            raise Error("field name '%s' is reserved" % name)
+        if any(field.name == name for field in self.fields):
+            raise Error("duplicate field '%s' in message '%s'"
+                % (name, self.name))
+        if type_name == "char" and count is None:
+            raise Error("char field '%s' must be an array" % name)
+        if type_name == "bool" and count is not None:
+            raise Error("bool field '%s' can not be an array" % name)
+        field = Field(type_name, count, name, self.size)
+        self.fields.append(field)
+        self.size += field.size
+
+
+def tokenize(text):
+    tokens = []
+    pos = 0
+    while text[pos:].strip():
+        match = TOKEN.match(text, pos)
+        if not match:
+            bad = len(text) - len(text[pos:].lstrip())
+            raise Error("line %d: unexpected character '%s'"
+                % (text.count("\n", 0, bad) + 1, text[bad]))
+        pos = match.end()
+        if match.group(1) is None:
+            line = text.count("\n", 0, match.start(match.lastindex)) + 1
+            tokens.append((match.group(match.lastindex), line))
+    return tokens
+
+
+def parse(text):
+    tokens = tokenize(text)
+    index = 0
+    namespace = None
+    messages = []
+
+    def next_token(expected=None):
+        nonlocal index
+        if index == len(tokens):
+            raise Error("unexpected end of file")
+        token, line = tokens[index]
+        if expected is not None and token != expected:
+            raise Error("line %d: expected '%s' but got '%s'"
+                % (line, expected, token))
+        index += 1
+        return token, line
+
+    def identifier():
+        token, line = next_token()
+        if not re.fullmatch(IDENTIFIER, token):
+            raise Error("line %d: expected identifier but got '%s'"
+                % (line, token))
+        return token
+
+    while index < len(tokens):
+        token, line = next_token()
+        if token == "namespace":
+            if namespace is not None or messages:
+                raise Error("line %d: namespace must be declared once "
+                    "before all messages" % line)
+            namespace, line = next_token()
+            if not re.fullmatch(IDENTIFIER + r"(::" + IDENTIFIER + r")*",
+                    namespace):
+                raise Error("line %d: invalid namespace '%s'"
+                    % (line, namespace))
+            next_token(";")
+        elif token == "message":
+            name = identifier()
+            if name in KEYWORDS:
+                raise Error("line %d: message name '%s' is reserved"
+                    % (line, name))
+            message = Message(name)
+            if any(m.name == message.name for m in messages):
+                raise Error("line %d: duplicate message '%s'"
+                    % (line, message.name))
+            next_token("{")
+            while True:
+                token, line = next_token()
+                if token == "}":
+                    break
+                if token not in TYPES:
+                    raise Error("line %d: unknown type '%s'" % (line, token))
+                count = None
+                if index < len(tokens) and tokens[index][0] == "[":
+                    next_token("[")
+                    count_token, line = next_token()
+                    if not count_token.isdigit() or int(count_token) == 0:
+                        raise Error("line %d: invalid array size '%s'"
+                            % (line, count_token))
+                    count = int(count_token)
+                    next_token("]")
+                name = identifier()
+                next_token(";")
+                try:
+                    message.add(token, count, name)
+                except Error as e:
+                    raise Error("line %d: %s" % (line, e))
+            if not message.fields:
+                raise Error("line %d: message '%s' has no fields"
+                    % (line, message.name))
+            messages.append(message)
+        else:
+            raise Error("line %d: expected 'namespace' or 'message' but "
+                "got '%s'" % (line, token))
+
+    return namespace, messages
+
+
+def view_accessor(field):
+    if field.type_name == "char":
+        return [
+            "boost::string_view %s()const noexcept{" % field.name,
+            "\treturn load_text(%d, %d);" % (field.offset, field.count),
+            "}",
+        ]
+    if field.count is None:
+        return [
+            "%s %s()const noexcept{" % (field.cpp_type, field.name),
+            "\treturn load< %s >(%d);" % (field.cpp_type, field.offset),
+            "}",
+        ]
+    return [
+        "static constexpr std::size_t %s_size()noexcept{" % field.name,
+        "\treturn %d;" % field.count,
+        "}",
+        "",
+        "%s %s(std::size_t i)const noexcept{" % (field.cpp_type, field.name),
+        "\treturn load< %s >(%d + i * %d);"
+            % (field.cpp_type, field.offset, field.element_size),
+        "}",
+    ]
+
+
+def builder_setter(field):
+    if field.type_name == "char":
+        return [
+            "builder& %s(boost::string_view value)noexcept{" % field.name,
+            "\tstore_text(%d, %d, value);" % (field.offset, field.count),
+            "\treturn *this;",
+            "}",
+        ]
+    if field.count is None:
+        return [
+            "builder& %s(%s value)noexcept{" % (field.name, field.cpp_type),
+            "\tstore< %s >(%d, value);" % (field.cpp_type, field.offset),
+            "\treturn *this;",
+            "}",
+        ]
+    return [
+        "static constexpr std::size_t %s_size()noexcept{" % field.name,
+        "\treturn %d;" % field.count,
+        "}",
+        "",
+        "builder& %s(std::size_t i, %s value)noexcept{"
+            % (field.name, field.cpp_type),
+        "\tstore< %s >(%d + i * %d, value);"
+            % (field.cpp_type, field.offset, field.element_size),
+        "\treturn *this;",
+        "}",
+    ]
+
+
+def indent(lines, depth):
+    return ["\t" * depth + line if line else "" for line in lines]
+
+
+def generate_message(message, depth):
+    lines = [
+        "/// \\brief Message %s, %d bytes" % (message.name, message.size),
+        "struct %s{" % message.name,
+        "\t/// \\brief Read only view on a received %s" % message.name,
+        "\tclass view: public webservice::fixed_message_view< %d >{"
+            % message.size,
+        "\tpublic:",
+        "\t\tusing fixed_message_view::fixed_message_view;",
+    ]
+    for field in message.fields:
+        lines.append("")
+        lines.extend(indent(view_accessor(field), 2))
+    lines += [
+        "\t};",
+        "",
+        "\t/// \\brief Build a %s to send" % message.name,
+        "\tclass builder: public webservice::fixed_message_builder< %d >{"
+            % message.size,
+        "\tpublic:",
+    ]
+    first = True
+    for field in message.fields:
+        if not first:
+            lines.append("")
+        first = False
+        lines.extend(indent(builder_setter(field), 2))
+    lines.append("\t};")
+    lines.append("};")
+    return indent(lines, depth)
+
+
+def generate_conversion(message, qualified):
+    view = "%s::view" % qualified
+    builder = "%s::builder" % qualified
+    return indent([
+        "template <>",
+        "struct from_multi_buffer_t< %s >{" % view,
+        "\t%s operator()(boost::beast::multi_buffer&& buffer)const{" % view,
+        "\t\treturn %s(std::move(buffer));" % view,
+        "\t}",
+        "};",
+        "",
+        "template <>",
+        "struct to_shared_const_buffer_t< %s >{" % builder,
+        "\tshared_const_buffer operator()(%s data)const{" % builder,
+        "\t\treturn data.freeze();",
+        "\t}",
+        "};",
+    ], 1)
+
+
+def generate(namespace, messages, source_name, guard_name):
+    namespaces = namespace.split("::") if namespace else []
+    guard = "_%s__hpp_INCLUDED_" % "__".join(namespaces + [guard_name])
+
+    lines = [
+        "// Generated by webservice_generate_messages.py from %s"
+            % source_name,
+        "// Do not edit!",
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        "#include <webservice/fixed_message.hpp>",
+        "",
+        "",
+    ]
+    for name in namespaces:
+        lines.append("namespace %s{" % name)
+    if namespaces:
+        lines += ["", ""]
+
+    depth = 1 if namespaces else 0
+    for message in messages:
+        lines.extend(generate_message(message, depth))
+        lines += ["", ""]
+
+    for _ in namespaces:
+        lines.append("}")
+    if namespaces:
+        lines += ["", ""]
+
+    lines += ["namespace webservice{", "", ""]
+    for message in messages:
+        qualified = "::" + "::".join(namespaces + [message.name])
+        lines.extend(generate_conversion(message, qualified))
+        lines += ["", ""]
+    lines += ["}", "", "", "#endif", ""]
+    return "\n".join(lines)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s <input.wsm> <output.hpp>\n" % argv[0])
+        return 2
+
+    source, target = argv[1], argv[2]
+    try:
+        with open(source) as file:
+            namespace, messages = parse(file.read())
+    except Error as e:
+        sys.stderr.write("%s: error: %s\n" % (source, e))
+        return 1
+
+    guard_name = re.sub(r"[^A-Za-z0-9_]", "_",
+        os.path.splitext(os.path.basename(target))[0])
+    code = generate(namespace, messages, os.path.basename(source), guard_name)
+
+    directory = os.path.dirname(target)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    with open(target, "w") as file:
+        file.write(code)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,36 @@
+# Fixed layout binary messages
+#
+#   webservice_generate_messages(<target> <file>...)
+#
+# Generates a header <name>.hpp for every message definition file <name>.wsm
+# and adds the output directory to the include directories of <target>. See
+# webservice_generate_messages.py for the definition format.
+
+set(WEBSERVICE_MESSAGE_GENERATOR
+    ${CMAKE_CURRENT_LIST_DIR}/webservice_generate_messages.py
+    CACHE INTERNAL "webservice message generator")
+
+function(webservice_generate_messages TARGET)
+    find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+    set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/webservice_messages)
+
+    set(HEADERS)
+    foreach(FILE ${ARGN})
+        get_filename_component(SOURCE ${FILE} ABSOLUTE)
+        get_filename_component(NAME ${FILE} NAME_WE)
+        set(HEADER ${OUTPUT_DIR}/${NAME}.hpp)
+
+        add_custom_command(OUTPUT ${HEADER}
+            COMMAND ${Python3_EXECUTABLE} ${WEBSERVICE_MESSAGE_GENERATOR}
+                ${SOURCE} ${HEADER}
+            DEPENDS ${SOURCE} ${WEBSERVICE_MESSAGE_GENERATOR}
+            COMMENT "Generating webservice messages ${NAME}.hpp"
+            VERBATIM)
+
+        list(APPEND HEADERS ${HEADER})
+    endforeach()
+
+    target_sources(${TARGET} PRIVATE ${HEADERS})
+    target_include_directories(${TARGET} PUBLIC ${OUTPUT_DIR})
+endfunction()
@@ -0,0 +1,239 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__admission_control__hpp_INCLUDED_
+#define _webservice__admission_control__hpp_INCLUDED_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+
+namespace webservice{
+
+
+	/// \brief Limits for new WebSocket sessions
+	///
+	/// Checked by the server when a WebSocket upgrade request arrives.
+	/// Rejected requests get an HTTP 503 response with a Retry-After header
+	/// before any WebSocket session is created. A limit of 0 means no limit.
+	///
+	/// Thread safe: Yes.
+	class admission_control{
+	public:
+		/// \brief A reserved session and handshake slot
+		///
+		/// Returned by admit(). The slot is released by the destructor, so
+		/// keep the ticket until the session has counted itself with
+		/// session_opened() and handshake_started().
+		class ticket{
+		public:
+			/// \brief No reservation
+			ticket()noexcept = default;
+
+			ticket(ticket&& other)noexcept
+				: control_(other.control_)
+			{
+				other.control_ = nullptr;
+			}
+
+			/// \brief Release the slot
+			~ticket(){
+				release();
+			}
+
+			ticket& operator=(ticket&& other)noexcept{
+				if(this != &other){
+					release();
+					control_ = other.control_;
+					other.control_ = nullptr;
+				}
+				return *this;
+			}
+
+
+			/// \brief true if a slot is reserved
+			explicit operator bool()const noexcept{
+				return control_ != nullptr;
+			}
+
+			/// \brief Release the slot now
+			void release()noexcept{
+				if(control_){
+					control_->sessions_.fetch_sub(1,
+						std::memory_order_relaxed);
+					control_->handshakes_.fetch_sub(1,
+						std::memory_order_relaxed);
+					control_ = nullptr;
+				}
+			}
+
+
+		private:
+			/// \brief Take the reserved slot of control
+			explicit ticket(admission_control& control)noexcept
+				: control_(&control) {}
+
+			/// \brief Owner of the slot, nullptr if none
+			admission_control* control_{nullptr};
+
+			friend class admission_control;
+		};
+
+
+		/// \brief Call on_lag_limit when a lag limit is set
+		///
+		/// The executor measures its lag only while somebody needs it.
+		explicit admission_control(
+			std::function< void() > on_lag_limit = std::function< void() >()
+		)
+			: on_lag_limit_(std::move(on_lag_limit)) {}
+
+		admission_control(admission_control const&) = delete;
+
+		admission_control& operator=(admission_control const&) = delete;
+
+
+		/// \brief Set max count of WebSocket sessions of all services
+		void set_max_sessions(std::size_t count)noexcept{
+			max_sessions_.store(count, std::memory_order_relaxed);
+		}
+
+		/// \brief Max count of WebSocket sessions of all services
+		std::size_t max_sessions()const noexcept{
+			return max_sessions_.load(std::memory_order_relaxed);
+		}
+
+
+		/// \brief Set max count of running WebSocket handshakes
+		void set_max_handshakes(std::size_t count)noexcept{
+			max_handshakes_.store(count, std::memory_order_relaxed);
+		}
+
+		/// \brief Max count of running WebSocket handshakes
+		std::size_t max_handshakes()const noexcept{
+			return max_handshakes_.load(std::memory_order_relaxed);
+		}
+
+
+		/// \brief Set max scheduling delay of the executor
+		void set_max_executor_lag(std::chrono::milliseconds lag)noexcept{
+			max_executor_lag_.store(lag.count(), std::memory_order_relaxed);
+			if(lag.count() != 0 && on_lag_limit_){
+				on_lag_limit_();
+			}
+		}
+
+		/// \brief Max scheduling delay of the executor
+		std::chrono::milliseconds max_executor_lag()const noexcept{
+			return std::chrono::milliseconds(
+				max_executor_lag_.load(std::memory_order_relaxed));
+		}
+
+
+		/// \brief Set the Retry-After time of rejection responses
+		void set_retry_after(std::chrono::seconds time)noexcept{
+			retry_after_.store(time.count(), std::memory_order_relaxed);
+		}
+
+		/// \brief Retry-After time of rejection responses
+		std::chrono::seconds retry_after()const noexcept{
+			return std::chrono::seconds(
+				retry_after_.load(std::memory_order_relaxed));
+		}
+
+
+		/// \brief Reserve a slot for a new WebSocket session
+		///
+		/// The session and the handshake counters are incremented with a
+		/// compare exchange, so concurrent upgrades can't overshoot the
+		/// limits. Returns an empty ticket if the session must be rejected.
+		ticket admit()noexcept;
+
+
+		/// \brief Current count of WebSocket sessions
+		std::size_t sessions()const noexcept{
+			return sessions_.load(std::memory_order_relaxed);
+		}
+
+		/// \brief Current count of running WebSocket handshakes
+		std::size_t handshakes()const noexcept{
+			return handshakes_.load(std::memory_order_relaxed);
+		}
+
+		/// \brief Last measured scheduling delay of the executor
+		std::chrono::milliseconds executor_lag()const noexcept{
+			return std::chrono::milliseconds(
+				executor_lag_.load(std::memory_order_relaxed));
+		}
+
+
+		/// \brief Called by every WebSocket session on construction
+		void session_opened()noexcept{
+			sessions_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/// \brief Called by every WebSocket session on destruction
+		void session_closed()noexcept{
+			sessions_.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/// \brief Called when a server session starts its handshake
+		void handshake_started()noexcept{
+			handshakes_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/// \brief Called when a server session finished its handshake
+		void handshake_finished()noexcept{
+			handshakes_.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/// \brief Called by the executor with a new measurement
+		void set_executor_lag(std::chrono::milliseconds lag)noexcept{
+			executor_lag_.store(lag.count(), std::memory_order_relaxed);
+		}
+
+
+	private:
+		/// \brief Increment count if it is below max, 0 means no limit
+		static bool reserve(
+			std::atomic< std::size_t >& count,
+			std::size_t max)noexcept;
+
+
+		/// \brief Called by set_max_executor_lag()
+		std::function< void() > const on_lag_limit_;
+
+		/// \brief Max count of WebSocket sessions, 0 for no limit
+		std::atomic< std::size_t > max_sessions_{0};
+
+		/// \brief Max count of running WebSocket handshakes, 0 for no limit
+		std::atomic< std::size_t > max_handshakes_{0};
+
+		/// \brief Max executor lag in milliseconds, 0 for no limit
+		std::atomic< std::chrono::milliseconds::rep > max_executor_lag_{0};
+
+		/// \brief Retry-After in seconds
+		std::atomic< std::chrono::seconds::rep > retry_after_{5};
+
+		/// \brief Current count of WebSocket sessions
+		std::atomic< std::size_t > sessions_{0};
+
+		/// \brief Current count of running WebSocket handshakes
+		std::atomic< std::size_t > handshakes_{0};
+
+		/// \brief Last measured executor lag in milliseconds
+		std::atomic< std::chrono::milliseconds::rep > executor_lag_{0};
+	};
+
+
+}
+
+
+#endif
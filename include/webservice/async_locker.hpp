@@ -12,10 +12,7 @@
 #include <atomic>
 #include <utility>
 #include <functional>
-
-#include <iostream>
-#include <iomanip>
-#include <mutex>
+#include <stdexcept>
 
 
 namespace webservice{
@@ -23,15 +20,21 @@ namespace webservice{
 
 	/// \brief Count async operations and calls a user defined function after
 	///        all async operations have returned
+	///
+	/// This is an intrusive reference count of the owning object. A lock is
+	/// one reference. Taking a lock is a single relaxed compare exchange,
+	/// releasing one is a single acquire-release decrement. Moving a lock
+	/// needs no read-modify-write operation.
 	class async_locker{
+		/// \brief Tag to adopt an already counted reference
+		struct adopt_t{};
+
 	public:
 		/// \brief Increase a counter on construction and decrese on destruction
 		class lock{
 		public:
 			/// \brief Initialize without lock
-			///
-			/// Thread safe: Yes.
-			lock()
+			lock()noexcept
 				: locker_(nullptr) {}
 
 
@@ -42,41 +45,39 @@ namespace webservice{
 			///
 			/// Thread safe: Yes.
 			lock(async_locker& locker)
-				: locker_(&locker)
+				: locker_(nullptr)
 			{
 				// lock_count_ must be increast by 1 before first usage. After
 				// that it must be decreased by 1. This makes sure that if
 				// lock_count_ is 0 the on_last_async() was already fired and
 				// no new calles are accepted
-				if((*locker_).lock_count_ == 0){
+				if(!locker.try_add_ref()){
 					throw std::runtime_error("async call after shutdown");
 				}
-
-				// If the call was valid increas the counter
-				++(*locker_).lock_count_;
+				locker_.store(&locker, std::memory_order_relaxed);
 			}
 
 			lock(lock const&) = delete;
 
 			/// \brief Move ownership of the lock
 			///
-			/// Thread safe: Yes.
+			/// Thread safe: No. other must not be used in parallel.
 			lock(lock&& other)noexcept
-				: locker_(other.locker_.exchange(
-					nullptr, std::memory_order_relaxed)) {}
+				: locker_(other.release_ownership()) {}
 
 			/// \brief Move ownership of the lock
 			///
-			/// Thread safe: Yes.
+			/// Thread safe: No. other must not be used in parallel.
 			lock& operator=(lock&& other)noexcept{
-				locker_ = other.locker_.exchange(
-					nullptr, std::memory_order_relaxed);
+				if(this != &other){
+					unlock();
+					locker_.store(other.release_ownership(),
+						std::memory_order_relaxed);
+				}
 				return *this;
 			}
 
 			/// \brief Call unlock()
-			///
-			/// Thread safe: Yes.
 			~lock(){
 				unlock();
 			}
@@ -87,12 +88,16 @@ namespace webservice{
 			///
 			/// Thread safe: Yes.
 			void unlock()noexcept{
-				auto locker =
+				// Moved from locks are the common case, they need no
+				// read-modify-write operation
+				if(locker_.load(std::memory_order_relaxed) == nullptr){
+					return;
+				}
+
+				auto const locker =
 					locker_.exchange(nullptr, std::memory_order_relaxed);
-				if(locker && --locker->lock_count_ == 0){
-					if(locker->on_last_async_callback_){
-						locker->on_last_async_callback_();
-					}
+				if(locker){
+					locker->release();
 				}
 			}
 
@@ -100,13 +105,31 @@ namespace webservice{
 			///
 			/// Thread safe: Yes.
 			bool is_locked()const noexcept{
-				return locker_ != nullptr;
+				return locker_.load(std::memory_order_relaxed) != nullptr;
 			}
 
 
 		private:
+			/// \brief Adopt a reference that was already counted
+			lock(async_locker* locker, adopt_t)noexcept
+				: locker_(locker) {}
+
+			/// \brief Take the pointer and leave this lock unlocked
+			async_locker* release_ownership()noexcept{
+				auto const locker = locker_.load(std::memory_order_relaxed);
+				locker_.store(nullptr, std::memory_order_relaxed);
+				return locker;
+			}
+
+
 			/// \brief Pointer to locked object
+			///
+			/// Atomic only to allow is_locked() and unlock() from other
+			/// threads, no operation needs more than relaxed ordering.
 			std::atomic< async_locker* > locker_;
+
+
+			friend class async_locker;
 		};
 
 
@@ -146,8 +169,6 @@ namespace webservice{
 		///
 		/// \throw std::logic_error If first_lock() was called more than one
 		///                         time
-		/// \throw std::runtime_error If no other async operation is still
-		///                           running
 		///
 		/// Thread safe: Yes.
 		lock make_first_lock(){
@@ -160,12 +181,7 @@ namespace webservice{
 					"async_locker::first_lock() called after first lock.");
 			}
 
-			lock result(*this);
-
-			// undo the first increase from compare_exchange_strong
-			--lock_count_;
-
-			return result;
+			return lock(this, adopt_t{});
 		}
 
 		/// \brief Generate a lock object
@@ -179,15 +195,49 @@ namespace webservice{
 			return lock(*this);
 		}
 
+		/// \brief Generate a lock object without throwing
+		///
+		/// The result is not locked if make_lock() would throw.
+		///
+		/// Thread safe: Yes.
+		lock try_make_lock()noexcept{
+			return try_add_ref() ? lock(this, adopt_t{}) : lock();
+		}
+
 		/// \brief Current count of running async operations
 		///
 		/// Thread safe: Yes.
 		std::size_t count()const noexcept{
-			return lock_count_;
+			return lock_count_.load(std::memory_order_relaxed);
 		}
 
 
 	private:
+		/// \brief Increase the counter if it is not 0
+		bool try_add_ref()noexcept{
+			// Relaxed is enough since the new reference is derived from an
+			// existing one, like copying a shared_ptr
+			auto count = lock_count_.load(std::memory_order_relaxed);
+			do{
+				if(count == 0){
+					return false;
+				}
+			}while(!lock_count_.compare_exchange_weak(count, count + 1,
+				std::memory_order_relaxed));
+			return true;
+		}
+
+		/// \brief Decrease the counter, call the callback if it becomes 0
+		void release()noexcept{
+			// The last release must see all writes of the other lock owners
+			if(lock_count_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+				if(on_last_async_callback_){
+					on_last_async_callback_();
+				}
+			}
+		}
+
+
 		/// \brief Called when the last async operation returned
 		std::function< void() > on_last_async_callback_;
 
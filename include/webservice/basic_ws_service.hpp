@@ -12,6 +12,8 @@
 #include "ws_service_base.hpp"
 #include "conversion.hpp"
 
+#include <atomic>
+
 
 namespace webservice{
 
@@ -71,6 +73,14 @@ namespace webservice{
 					static_cast< SendTextTypeT&& >(data)));
 		}
 
+		/// \brief Send a text message to the session indexed by key
+		template < typename Key, typename SendTextTypeT >
+		void send_text_to_key(Key&& key, SendTextTypeT&& data){
+			ws_service_base< Value >::send_text_to_key(
+				static_cast< Key&& >(key), text_to_shared_const_buffer(
+					static_cast< SendTextTypeT&& >(data)));
+		}
+
 
 		/// \brief Send a binary message to all sessions
 		template < typename SendBinaryTypeT >
@@ -96,6 +106,14 @@ namespace webservice{
 					static_cast< SendBinaryTypeT&& >(data)));
 		}
 
+		/// \brief Send a binary message to the session indexed by key
+		template < typename Key, typename SendBinaryTypeT >
+		void send_binary_to_key(Key&& key, SendBinaryTypeT&& data){
+			ws_service_base< Value >::send_binary_to_key(
+				static_cast< Key&& >(key), binary_to_shared_const_buffer(
+					static_cast< SendBinaryTypeT&& >(data)));
+		}
+
 
 	private:
 		/// \brief Called when a session received a text message
@@ -113,6 +131,43 @@ namespace webservice{
 			ReceiveBinaryType&& /*data*/){}
 
 
+		/// \brief Called when a session received a text message
+		///
+		/// value is the value of the session, it is locked while the handler
+		/// runs. Don't call with_value() for identifier from here. If the
+		/// handler changes the ws_session_key_t key of value, the session is
+		/// reindexed async.
+		///
+		/// Default implementation leaves data untouched and makes the caller
+		/// use on_text without value after the lock was released. The value
+		/// is no longer locked for further text messages.
+		virtual void on_text(
+			ws_identifier /*identifier*/,
+			Value& /*value*/,
+			ReceiveTextType&& /*data*/
+		){
+			text_with_value_.store(false, std::memory_order_relaxed);
+		}
+
+		/// \brief Called when a session received a binary message
+		///
+		/// value is the value of the session, it is locked while the handler
+		/// runs. Don't call with_value() for identifier from here. If the
+		/// handler changes the ws_session_key_t key of value, the session is
+		/// reindexed async.
+		///
+		/// Default implementation leaves data untouched and makes the caller
+		/// use on_binary without value after the lock was released. The value
+		/// is no longer locked for further binary messages.
+		virtual void on_binary(
+			ws_identifier /*identifier*/,
+			Value& /*value*/,
+			ReceiveBinaryType&& /*data*/
+		){
+			binary_with_value_.store(false, std::memory_order_relaxed);
+		}
+
+
 
 		/// \brief Called when a session received a text message
 		///
@@ -122,7 +177,19 @@ namespace webservice{
 			boost::beast::multi_buffer&& buffer
 		)final{
 			try{
-				on_text(identifier, multi_buffer_to_text(buffer));
+				auto data = multi_buffer_to_text(std::move(buffer));
+				if(text_with_value_.load(std::memory_order_relaxed)){
+					this->with_value(identifier, [&](Value& value){
+							on_text(identifier, value, std::move(data));
+						});
+
+					// still true if on_text with value is overridden
+					if(text_with_value_.load(std::memory_order_relaxed)){
+						return;
+					}
+				}
+
+				on_text(identifier, std::move(data));
 			}catch(...){
 				this->on_exception(identifier, std::current_exception());
 			}
@@ -136,11 +203,30 @@ namespace webservice{
 			boost::beast::multi_buffer&& buffer
 		)final{
 			try{
-				on_binary(identifier, multi_buffer_to_binary(buffer));
+				auto data = multi_buffer_to_binary(std::move(buffer));
+				if(binary_with_value_.load(std::memory_order_relaxed)){
+					this->with_value(identifier, [&](Value& value){
+							on_binary(identifier, value, std::move(data));
+						});
+
+					// still true if on_binary with value is overridden
+					if(binary_with_value_.load(std::memory_order_relaxed)){
+						return;
+					}
+				}
+
+				on_binary(identifier, std::move(data));
 			}catch(...){
 				this->on_exception(identifier, std::current_exception());
 			}
 		}
+
+
+		/// \brief false if on_text with value is not overridden
+		std::atomic< bool > text_with_value_{true};
+
+		/// \brief false if on_binary with value is not overridden
+		std::atomic< bool > binary_with_value_{true};
 	};
 #ifdef __clang__
 #pragma clang diagnostic pop
@@ -14,7 +14,12 @@
 #include <boost/beast/core/multi_buffer.hpp>
 
 #include <type_traits>
+#include <stdexcept>
+#include <iterator>
 #include <utility>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 
 namespace webservice{
@@ -45,6 +50,15 @@ namespace webservice{
 			: std::true_type{};
 
 
+		template < typename T, typename = void >
+		struct has_byte_value_type: std::false_type{};
+
+		template < typename T >
+		struct has_byte_value_type< T,
+				std::enable_if_t< sizeof(typename T::value_type) == 1 > >
+			: std::true_type{};
+
+
 		template < typename T, typename = void >
 		struct call_reserve{
 			void operator()(T&, std::size_t)const{}
@@ -82,7 +96,8 @@ namespace webservice{
 	struct from_multi_buffer_t{
 		static_assert(
 			std::is_default_constructible< T >::value &&
-			detail::has_insert_function< T >::value,
+			detail::has_insert_function< T >::value &&
+			detail::has_byte_value_type< T >::value,
 			"T must be default constructable, have a type member value_type "
 			"with sizeof equal 1 as well as the iterator functions .end() and "
 			".insert(iterator, const value_type*, const value_type*); "
@@ -93,12 +108,14 @@ namespace webservice{
 		T operator()(boost::beast::multi_buffer const& buffer)const{
 			T result;
 
+			auto const buffers = buffer.data();
+
 			detail::call_reserve< T > reserve;
-			reserve(result, boost::asio::buffer_size(buffer.data()));
+			reserve(result, boost::asio::buffer_size(buffers));
 
-			auto const end = boost::asio::buffer_sequence_end(buffer.data());
+			auto const end = boost::asio::buffer_sequence_end(buffers);
 			for(
-				auto iter = boost::asio::buffer_sequence_begin(buffer.data());
+				auto iter = boost::asio::buffer_sequence_begin(buffers);
 				iter != end; ++iter
 			){
 				boost::asio::const_buffer buffer(*iter);
@@ -113,6 +130,169 @@ namespace webservice{
 	};
 
 
+	namespace detail{
+
+
+		/// \brief Count of T elements in buffers
+		///
+		/// \throw std::runtime_error if the size of buffers is not a
+		///                           multiple of sizeof(T)
+		template < typename T, typename Buffers >
+		std::size_t element_count(Buffers const& buffers){
+			auto const bytes = boost::asio::buffer_size(buffers);
+			if(bytes % sizeof(T) != 0){
+				throw std::runtime_error("message size " +
+					std::to_string(bytes) +
+					" is not a multiple of the element size " +
+					std::to_string(sizeof(T)));
+			}
+			return bytes / sizeof(T);
+		}
+
+
+	}
+
+
+	/// \brief Copy a message into a vector of trivially copyable elements
+	///
+	/// Segment boundaries and alignment don't matter since the bytes are
+	/// copied.
+	template < typename T, typename Allocator >
+	struct from_multi_buffer_t< std::vector< T, Allocator > >{
+		static_assert(std::is_trivially_copyable< T >::value,
+			"T must be trivially copyable; alternatively you can specialize "
+			"from_multi_buffer_t< std::vector< T > >");
+
+		std::vector< T, Allocator > operator()(
+			boost::beast::multi_buffer const& buffer
+		)const{
+			auto const buffers = buffer.data();
+			std::vector< T, Allocator > result(
+				detail::element_count< T >(buffers));
+			boost::asio::buffer_copy(
+				boost::asio::buffer(result.data(), result.size() * sizeof(T)),
+				buffers);
+			return result;
+		}
+	};
+
+
+	/// \brief Read only view of a received message as array of T
+	///
+	/// Takes ownership of the message. If the message is contiguous and
+	/// aligned for T, the elements are used in place, otherwise they are
+	/// copied once.
+	template < typename T >
+	class multi_buffer_span{
+	public:
+		static_assert(std::is_trivially_copyable< T >::value,
+			"T must be trivially copyable");
+
+		using value_type = T;
+		using const_iterator = T const*;
+
+
+		/// \brief View on buffer
+		///
+		/// \throw std::runtime_error if the size of buffer is not a multiple
+		///                           of sizeof(T)
+		explicit multi_buffer_span(boost::beast::multi_buffer&& buffer)
+			: buffer_(std::move(buffer))
+		{
+			auto const buffers = buffer_.data();
+			size_ = detail::element_count< T >(buffers);
+
+			auto const begin = boost::asio::buffer_sequence_begin(buffers);
+			auto const end = boost::asio::buffer_sequence_end(buffers);
+			if(begin != end && std::next(begin) == end){
+				auto const data = boost::asio::const_buffer(*begin).data();
+				if(reinterpret_cast< std::uintptr_t >(data) % alignof(T) == 0){
+					data_ = static_cast< T const* >(data);
+					return;
+				}
+			}
+
+			copy_.resize(size_);
+			boost::asio::buffer_copy(
+				boost::asio::buffer(copy_.data(), size_ * sizeof(T)), buffers);
+			data_ = copy_.data();
+		}
+
+		/// \brief Copy the message of other
+		///
+		/// The copy has its own message, its elements don't point into other.
+		multi_buffer_span(multi_buffer_span const& other)
+			: multi_buffer_span(boost::beast::multi_buffer(other.buffer_)) {}
+
+		/// \brief Take the message of other, the elements don't move
+		multi_buffer_span(multi_buffer_span&& other) = default;
+
+
+		/// \brief Copy the message of other
+		multi_buffer_span& operator=(multi_buffer_span const& other){
+			return *this = multi_buffer_span(other);
+		}
+
+		/// \brief Take the message of other, the elements don't move
+		multi_buffer_span& operator=(multi_buffer_span&& other) = default;
+
+
+
+		/// \brief true if the elements are used in place
+		bool is_zero_copy()const noexcept{
+			return copy_.empty();
+		}
+
+
+		T const* data()const noexcept{
+			return data_;
+		}
+
+		std::size_t size()const noexcept{
+			return size_;
+		}
+
+		bool empty()const noexcept{
+			return size_ == 0;
+		}
+
+		T const* begin()const noexcept{
+			return data_;
+		}
+
+		T const* end()const noexcept{
+			return data_ + size_;
+		}
+
+		T const& operator[](std::size_t i)const noexcept{
+			return data_[i];
+		}
+
+
+	private:
+		/// \brief The message
+		boost::beast::multi_buffer buffer_;
+
+		/// \brief Aligned copy if the message can't be used in place
+		std::vector< T > copy_;
+
+		/// \brief First element
+		T const* data_{nullptr};
+
+		/// \brief Count of elements
+		std::size_t size_{0};
+	};
+
+	template < typename T >
+	struct from_multi_buffer_t< multi_buffer_span< T > >{
+		multi_buffer_span< T > operator()(
+			boost::beast::multi_buffer&& buffer
+		)const{
+			return multi_buffer_span< T >(std::move(buffer));
+		}
+	};
+
+
 }
 
 
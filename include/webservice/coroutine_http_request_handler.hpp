@@ -0,0 +1,54 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__coroutine_http_request_handler__hpp_INCLUDED_
+#define _webservice__coroutine_http_request_handler__hpp_INCLUDED_
+
+#include "task.hpp"
+#include "http_request_handler.hpp"
+
+
+namespace webservice{
+
+
+	/// \brief HTTP request handler that runs a coroutine per request
+	///
+	/// The coroutine can co_await tasks and async backends, e.g. with
+	/// resume_on(*executor().blocking_io_context()), and answers with
+	/// send(response) once. The session waits for the response, later
+	/// requests of the session are answered in order.
+	///
+	/// Requires C++20.
+	class coroutine_http_request_handler: public http_request_handler{
+	public:
+		using http_request_handler::http_request_handler;
+
+
+		/// \brief Start the coroutine of the request
+		void operator()(http_request&& req, http_response&& send)final{
+			auto task = on_request(std::move(req), std::move(send));
+			task.start(nullptr, [this](std::exception_ptr error)noexcept{
+					on_exception(error);
+				});
+		}
+
+
+	private:
+		/// \brief The coroutine of a request
+		///
+		/// Exceptions that leave it are reported to on_exception().
+		virtual detached_task on_request(
+			http_request req,
+			http_response send) = 0;
+	};
+
+
+}
+
+
+#endif
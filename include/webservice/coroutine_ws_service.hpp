@@ -0,0 +1,402 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__coroutine_ws_service__hpp_INCLUDED_
+#define _webservice__coroutine_ws_service__hpp_INCLUDED_
+
+#include "task.hpp"
+#include "ws_service_base.hpp"
+
+#include <boost/system/system_error.hpp>
+
+#include <deque>
+#include <mutex>
+
+
+namespace webservice{
+
+
+	/// \brief A received WebSocket message
+	struct ws_message{
+		/// \brief true for text, false for binary messages
+		bool is_text;
+
+		/// \brief The message data
+		boost::beast::multi_buffer data;
+	};
+
+
+	class coroutine_ws_service;
+
+
+	/// \brief A WebSocket session as seen by its coroutine
+	///
+	/// Exists until the coroutine returned and the session was erased.
+	class ws_coroutine_session{
+	public:
+		/// \brief Awaitable of receive()
+		class receive_awaiter{
+		public:
+			bool await_ready()const{
+				std::lock_guard< std::mutex > lock(session_.mutex_);
+				return !session_.messages_.empty() || session_.closed_;
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle){
+				std::lock_guard< std::mutex > lock(session_.mutex_);
+				if(!session_.messages_.empty() || session_.closed_){
+					return false;
+				}
+
+				session_.receiver_ = handle;
+				return true;
+			}
+
+			/// \brief The next message, empty if the session was closed
+			std::optional< ws_message > await_resume()const{
+				std::lock_guard< std::mutex > lock(session_.mutex_);
+				if(session_.messages_.empty()){
+					return std::nullopt;
+				}
+
+				auto message = std::move(session_.messages_.front());
+				session_.messages_.pop_front();
+				return message;
+			}
+
+
+		private:
+			explicit receive_awaiter(ws_coroutine_session& session)noexcept
+				: session_(session) {}
+
+
+			/// \brief The receiving session
+			ws_coroutine_session& session_;
+
+
+			friend class ws_coroutine_session;
+		};
+
+		/// \brief Awaitable of send_text() and send_binary()
+		class send_awaiter{
+		public:
+			send_awaiter(send_awaiter const&) = delete;
+
+			send_awaiter& operator=(send_awaiter const&) = delete;
+
+
+			bool await_ready()const noexcept{
+				return false;
+			}
+
+			/// \brief Queue the message, resume after it was written
+			void await_suspend(std::coroutine_handle<> handle);
+
+			/// \throw boost::system::system_error If the message was not
+			///                                    written
+			void await_resume()const{
+				if(ec_){
+					throw boost::system::system_error(ec_,
+						"websocket coroutine send");
+				}
+			}
+
+
+		private:
+			send_awaiter(
+				ws_coroutine_session& session,
+				bool is_text,
+				shared_const_buffer buffer
+			)noexcept
+				: session_(session)
+				, is_text_(is_text)
+				, buffer_(std::move(buffer)) {}
+
+
+			/// \brief Store ec and resume the coroutine
+			static void on_written(
+				void* context,
+				boost::system::error_code ec);
+
+
+			/// \brief The sending session
+			ws_coroutine_session& session_;
+
+			/// \brief Send as text or as binary message
+			bool is_text_;
+
+			/// \brief The message
+			shared_const_buffer buffer_;
+
+			/// \brief The awaiting coroutine
+			std::coroutine_handle<> handle_;
+
+			/// \brief Result of the write
+			boost::system::error_code ec_;
+
+
+			friend class ws_coroutine_session;
+		};
+
+
+		/// \brief Constructor
+		ws_coroutine_session(
+			coroutine_ws_service& service,
+			ws_identifier identifier,
+			async_locker::lock&& lock
+		)
+			: lock_(std::move(lock))
+			, service_(service)
+			, identifier_(identifier) {}
+
+		ws_coroutine_session(ws_coroutine_session const&) = delete;
+
+		ws_coroutine_session& operator=(ws_coroutine_session const&)
+			= delete;
+
+
+		/// \brief Identifier of the session in the service
+		ws_identifier identifier()const noexcept{
+			return identifier_;
+		}
+
+		/// \brief Wait for the next message
+		///
+		/// co_await returns an empty optional after the session was closed
+		/// and all messages were received. Messages that arrive while the
+		/// coroutine doesn't wait are queued.
+		receive_awaiter receive()noexcept{
+			return receive_awaiter(*this);
+		}
+
+		/// \brief Send a text message, co_await completes after the write
+		send_awaiter send_text(shared_const_buffer buffer)noexcept{
+			return send_awaiter(*this, true, std::move(buffer));
+		}
+
+		/// \brief Send a binary message, co_await completes after the write
+		send_awaiter send_binary(shared_const_buffer buffer)noexcept{
+			return send_awaiter(*this, false, std::move(buffer));
+		}
+
+		/// \brief Close the session
+		void close(boost::beast::websocket::close_reason reason);
+
+
+	private:
+		/// \brief Add a received message, resume a waiting receive()
+		///
+		/// The coroutine runs on the calling thread.
+		void push(ws_message&& message){
+			std::unique_lock< std::mutex > lock(mutex_);
+			messages_.push_back(std::move(message));
+			auto const receiver = std::exchange(receiver_, nullptr);
+			lock.unlock();
+
+			if(receiver){
+				receiver.resume();
+			}
+		}
+
+		/// \brief Mark as closed, resume a waiting receive()
+		void on_closed()noexcept{
+			std::unique_lock< std::mutex > lock(mutex_);
+			closed_ = true;
+			auto const receiver = std::exchange(receiver_, nullptr);
+			lock.unlock();
+
+			if(receiver){
+				post_resume(receiver);
+			}
+		}
+
+		/// \brief Resume the coroutine on a thread of the executor
+		void post_resume(std::coroutine_handle<> handle)noexcept;
+
+
+		/// \brief Keep the service alive until the coroutine returned
+		async_locker::lock lock_;
+
+		/// \brief The owning service
+		coroutine_ws_service& service_;
+
+		/// \brief Identifier of the session
+		ws_identifier const identifier_;
+
+		/// \brief Protects messages_, receiver_ and closed_
+		std::mutex mutex_;
+
+		/// \brief Received messages that were not yet awaited
+		std::deque< ws_message > messages_;
+
+		/// \brief Coroutine that waits in receive(), may be nullptr
+		std::coroutine_handle<> receiver_;
+
+		/// \brief true after the session was erased
+		bool closed_{false};
+
+
+		friend class coroutine_ws_service;
+	};
+
+
+	/// \brief WebSocket service that runs a coroutine per session
+	///
+	/// Instead of a handler per message, every session runs on_session().
+	/// The coroutine waits for messages with co_await session.receive() and
+	/// sends with co_await session.send_text() or send_binary().
+	/// Shutdown waits until all coroutines returned, so they must return
+	/// after receive() reported the end of the session.
+	///
+	/// Requires C++20.
+	class coroutine_ws_service
+		: public ws_service_base< std::shared_ptr< ws_coroutine_session > >
+	{
+	public:
+		using ws_service_base::ws_service_base;
+
+
+	private:
+		/// \brief The coroutine of a session
+		///
+		/// Started when the session opens. Exceptions that leave it are
+		/// reported to on_exception().
+		virtual detached_task on_session(ws_coroutine_session& session) = 0;
+
+
+		/// \brief Start the coroutine
+		void on_open(ws_identifier identifier)final{
+			auto session = std::make_shared< ws_coroutine_session >(
+				*this, identifier, locker_.make_lock());
+			with_value(identifier,
+				[&session](std::shared_ptr< ws_coroutine_session >& value){
+					value = session;
+				});
+
+			auto task = on_session(*session);
+			task.start(std::move(session),
+				[this, identifier](std::exception_ptr error)noexcept{
+					on_exception(identifier, error);
+				});
+		}
+
+		/// \brief Pass the message to the coroutine
+		void on_text(
+			ws_identifier identifier,
+			boost::beast::multi_buffer&& buffer
+		)final{
+			deliver(identifier, ws_message{true, std::move(buffer)});
+		}
+
+		/// \brief Pass the message to the coroutine
+		void on_binary(
+			ws_identifier identifier,
+			boost::beast::multi_buffer&& buffer
+		)final{
+			deliver(identifier, ws_message{false, std::move(buffer)});
+		}
+
+		/// \brief Tell the coroutine that the session ended
+		void on_value_erase(
+			ws_identifier /*identifier*/,
+			std::shared_ptr< ws_coroutine_session >&& session
+		)final{
+			if(session){
+				session->on_closed();
+			}
+		}
+
+		/// \brief Pass message to the coroutine of identifier
+		void deliver(ws_identifier identifier, ws_message&& message){
+			// The value exists until the session is erased, which happens
+			// after its last handler
+			auto const session = with_value(identifier,
+				[](std::shared_ptr< ws_coroutine_session >& value){
+					return value.get();
+				});
+
+			if(session){
+				session->push(std::move(message));
+			}
+		}
+
+
+		/// \brief Create a new ws_session
+		void on_server_connect(
+			boost::asio::ip::tcp::socket&& socket,
+			http_request&& req
+		){
+			async_server_connect(std::move(socket), std::move(req));
+		}
+
+		/// \brief Create a new client websocket session
+		void on_client_connect(
+			std::string&& host,
+			std::string&& port,
+			std::string&& resource
+		){
+			async_client_connect(std::move(host), std::move(port),
+				std::move(resource));
+		}
+
+
+		friend class ws_coroutine_session;
+	};
+
+
+	inline void ws_coroutine_session::send_awaiter::await_suspend(
+		std::coroutine_handle<> handle
+	){
+		handle_ = handle;
+
+		// If the session already ended the handler reports
+		// operation_aborted
+		ws_write_handler handler(&on_written, this);
+		try{
+			auto& service = session_.service_;
+			if(is_text_){
+				service.send_text(session_.identifier_, std::move(buffer_),
+					std::move(handler));
+			}else{
+				service.send_binary(session_.identifier_, std::move(buffer_),
+					std::move(handler));
+			}
+		}catch(...){
+			// handler was destroyed and resumes with operation_aborted
+		}
+	}
+
+	inline void ws_coroutine_session::send_awaiter::on_written(
+		void* context,
+		boost::system::error_code ec
+	){
+		auto& self = *static_cast< send_awaiter* >(context);
+		self.ec_ = ec;
+		self.session_.post_resume(self.handle_);
+	}
+
+	inline void ws_coroutine_session::post_resume(
+		std::coroutine_handle<> handle
+	)noexcept try{
+		boost::asio::post(service_.executor().get_io_context(),
+			bind_recycling_allocator([handle]{ handle.resume(); }));
+	}catch(...){
+		service_.on_exception(identifier_, std::current_exception());
+	}
+
+	inline void ws_coroutine_session::close(
+		boost::beast::websocket::close_reason reason
+	){
+		service_.close(identifier_, std::move(reason));
+	}
+
+
+}
+
+
+#endif
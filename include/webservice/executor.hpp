@@ -10,10 +10,22 @@
 #define _webservice__executor__hpp_INCLUDED_
 
 #include "error_handler.hpp"
+#include "admission_control.hpp"
+#include "executor_stats.hpp"
+#include "async_locker.hpp"
 
 #include <boost/asio/io_context.hpp>
-
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <thread>
 #include <mutex>
@@ -22,6 +34,86 @@
 namespace webservice{
 
 
+	/// \brief How sessions are distributed over the executor threads
+	enum class session_placement{
+		/// \brief All threads run one shared io_context
+		shared,
+
+		/// \brief One io_context per thread, new sessions go to the threads
+		///        in turn
+		round_robin,
+
+		/// \brief One io_context per thread, new sessions go to the thread
+		///        with the fewest sessions
+		least_loaded
+	};
+
+
+	/// \brief Placement and names of the executor threads
+	struct thread_options{
+		/// \brief Options with placement
+		thread_options(
+			session_placement placement = session_placement::shared
+		)noexcept
+			: placement(placement) {}
+
+
+		/// \brief Distribution of the sessions over the threads
+		session_placement placement;
+
+		/// \brief CPUs per thread, thread i runs on cpus[i % cpus.size()]
+		///
+		/// Threads are not pinned if empty. Memory is not bound to a NUMA
+		/// node, its placement is left to the operating system. Only
+		/// supported on Linux, ignored elsewhere.
+		std::vector< std::vector< unsigned > > cpus;
+
+		/// \brief Thread name prefix, the thread index is appended
+		///
+		/// Linux truncates names to 15 characters. No names are set if
+		/// empty.
+		std::string name = "webservice";
+
+
+		/// \brief Lower bound of the elastic thread count
+		std::size_t min_threads = 1;
+
+		/// \brief Upper bound of the elastic thread count, 0 disables it
+		///
+		/// Only supported with session_placement::shared.
+		std::size_t max_threads = 0;
+
+		/// \brief Add a thread if the scheduling delay exceeds this
+		std::chrono::milliseconds grow_lag{10};
+
+		/// \brief Remove a thread if the scheduling delay stays below this
+		///        for shrink_delay
+		std::chrono::milliseconds shrink_lag{2};
+
+		/// \brief Time of small scheduling delay before a thread is removed
+		std::chrono::milliseconds shrink_delay{60000};
+
+
+		/// \brief Count of threads that run only WebSocket sessions
+		///
+		/// If not 0, WebSocket sessions run on an own io_context, so HTTP
+		/// traffic can't delay their IO and timers.
+		std::size_t ws_threads = 0;
+
+		/// \brief Count of threads for blocking operations
+		///
+		/// If not 0, file_request_handler opens files on these threads.
+		std::size_t blocking_threads = 0;
+
+
+		/// \brief Measure the scheduling delay for executor::stats()
+		///
+		/// The delay is also measured if max_threads is not 0 or if an
+		/// admission_control lag limit is set.
+		bool measure_lag = false;
+	};
+
+
 	/// \brief Base class for server error handlers
 	class executor{
 	public:
@@ -35,6 +127,11 @@ namespace webservice{
 			: ioc_(ioc)
 			, error_handler_(std::move(handler))
 			, shutdown_fn_(static_cast< ShutdownFn&& >(shutdown_fn))
+			, admission_([this]{ start_probe(); })
+			, probe_strand_(ioc.get_executor())
+			, probe_timer_(ioc)
+			, locker_([this]()noexcept{ on_last_lock(); })
+			, run_lock_(locker_.make_first_lock())
 		{
 			static_assert(noexcept(static_cast< ShutdownFn&& >(shutdown_fn)),
 				"shutdown_fn must be noexcept");
@@ -56,13 +153,55 @@ namespace webservice{
 
 
 		/// \brief Run the io_context on all threads
-		void run(std::uint8_t thread_count);
+		///
+		/// With session_placement::shared all threads run the io_context.
+		/// Otherwise the io_context is run by the first thread and every
+		/// other thread runs an own io_context. Sessions stay on the thread
+		/// that session_io_context() selected for them, so all of their IO,
+		/// handlers and timers run without crossing threads.
+		///
+		/// With a thread_count of 0 no thread is started. The owner of the
+		/// io_context runs it then, e.g. a thread pool that is shared by
+		/// several servers and clients.
+		///
+		/// \throw std::logic_error If thread_count is 0 and options requires
+		///                         own threads
+		void run(
+			std::size_t thread_count,
+			thread_options options = thread_options());
+
+		/// \brief Change the count of threads that run the io_context
+		///
+		/// Surplus threads return after their current handler. Only
+		/// supported with session_placement::shared. Ignored after
+		/// shutdown(). Joins the threads that returned before, so don't
+		/// call it from a handler.
+		///
+		/// The io_context was created with concurrency_hint() of the
+		/// thread count of run(), so thread_count must not exceed it. Set
+		/// thread_options::max_threads to allow more threads.
+		///
+		/// \throw std::logic_error If thread_count is 0 or exceeds the
+		///                         concurrency hint, the placement is not
+		///                         shared or the executor runs no own
+		///                         threads
+		void resize(std::size_t thread_count);
+
+		/// \brief Current target count of threads
+		std::size_t thread_count()noexcept;
+
+		/// \brief io_context concurrency hint for thread_count and options
+		static int concurrency_hint(
+			std::size_t thread_count,
+			thread_options const& options)noexcept;
 
 
 		/// \brief Wait on all processing threads
 		///
 		/// This effecivly blocks the current thread until the server_impl is
-		/// closed.
+		/// closed. Without own threads it waits until all locks from
+		/// make_lock() are released, so the io_context must still be run by
+		/// other threads.
 		void block()noexcept;
 
 		/// \brief Don't accept new connections and async tasks
@@ -78,17 +217,142 @@ namespace webservice{
 		/// \brief Get reference to the internal io_context
 		boost::asio::io_context& get_io_context()noexcept;
 
+		/// \brief io_context for a new session
+		///
+		/// The internal io_context with session_placement::shared, otherwise
+		/// the io_context of the thread selected by the placement.
+		boost::asio::io_context& session_io_context()noexcept;
+
+		/// \brief io_context for a new WebSocket session
+		///
+		/// The own WebSocket io_context if thread_options::ws_threads is not
+		/// 0, otherwise session_io_context().
+		boost::asio::io_context& ws_io_context()noexcept;
+
+		/// \brief io_context for blocking operations, nullptr if none
+		boost::asio::io_context* blocking_io_context()noexcept;
+
+		/// \brief Move the socket of an upgraded HTTP session to the
+		///        WebSocket io_context if there is one
+		boost::asio::ip::tcp::socket to_ws_context(
+			boost::asio::ip::tcp::socket&& socket);
+
+		/// \brief Move an open socket to the io_context ioc
+		///
+		/// Returns socket unchanged if it already runs on ioc, if it can't
+		/// be released, e.g. after the peer reset it, or if the Boost
+		/// version can't release a socket (before 1.70).
+		static boost::asio::ip::tcp::socket move_socket(
+			boost::asio::ip::tcp::socket&& socket,
+			boost::asio::io_context& ioc);
+
+		/// \brief The io_context a socket runs on
+		///
+		/// Since Boost 1.70 a socket has a polymorphic executor, so the
+		/// context must be cast back to the io_context that created it.
+		static boost::asio::io_context& io_context_of(
+			boost::asio::ip::tcp::socket& socket)noexcept;
+
+		/// \brief Count a session that runs on context for least_loaded
+		///        placement
+		void session_opened(boost::asio::execution_context& context)noexcept;
+
+		/// \brief Uncount a session that runs on context
+		void session_closed(boost::asio::execution_context& context)noexcept;
+
 		/// \brief true after all tasks have finished
 		bool is_stopped()noexcept;
 
+		/// \brief Keep block() waiting until the lock is released
+		///
+		/// Async operations that don't run on own threads of the executor
+		/// must hold such a lock, since the io_context may outlive the
+		/// executor.
+		///
+		/// \throw std::runtime_error If all locks were released after
+		///                           shutdown()
+		///
+		/// Thread safe: Yes.
+		async_locker::lock make_lock(){
+			return locker_.make_lock();
+		}
+
 
 		/// \brief Reference to the error_handler
 		error_handler& error()const{
 			return *error_handler_;
 		}
 
+		/// \brief Limits for new WebSocket sessions
+		class admission_control& admission()noexcept{
+			return admission_;
+		}
+
+		/// \brief Scheduling delay histogram and per thread statistics
+		///
+		/// The scheduling delay is measured every 100 ms by posting a probe
+		/// handler to the io_context, if thread_options::measure_lag is set
+		/// or another feature needs it. The histogram stays empty otherwise.
+		///
+		/// Thread safe: Yes.
+		executor_stats stats();
+
 
 	private:
+		/// \brief Start do_probe() if it doesn't run yet
+		void start_probe()noexcept;
+
+		/// \brief Measure the scheduling delay periodically
+		///
+		/// Waits probe_interval, then posts a handler to the io_context and
+		/// reports the time until it runs to admission_ and the statistics.
+		void do_probe();
+
+		/// \brief Add a probe result to the statistics
+		void record_lag(std::chrono::microseconds lag)noexcept;
+
+		/// \brief Stop the delay measurement
+		void stop_probe()noexcept;
+
+		/// \brief Run ioc until it is out of work
+		void run_io_context(boost::asio::io_context& ioc, std::size_t index);
+
+		/// \brief Run ioc like run() and count handlers and time
+		///
+		/// After every handler the thread claims one of the retirements of
+		/// retire, if it is not nullptr.
+		///
+		/// \return true if the thread retired, false if ioc ran out of work
+		static bool run_counted(
+			boost::asio::io_context& ioc,
+			detail::thread_counters& counters,
+			std::atomic< std::size_t >* retire);
+
+		/// \brief Set the target count of threads that run ioc_
+		///
+		/// Starts threads or requests their retirement, joins none of them.
+		/// mutex_ must be locked.
+		void set_thread_count(std::size_t thread_count);
+
+		/// \brief Apply affinity and name of thread index to this thread
+		void setup_thread(std::size_t index)noexcept;
+
+		/// \brief Start a thread that runs ioc
+		///
+		/// mutex_ must be locked.
+		void start_thread(boost::asio::io_context& ioc);
+
+		/// \brief Grow or shrink the thread count by the measured lag
+		void adapt_thread_count(std::chrono::milliseconds lag)noexcept;
+
+		/// \brief Index of context in session_contexts_
+		std::size_t context_index(
+			boost::asio::execution_context& context)const noexcept;
+
+		/// \brief Called when the last lock was released, wakes block()
+		void on_last_lock()noexcept;
+
+
 		/// \brief Reference to the io_context
 		boost::asio::io_context& ioc_;
 
@@ -101,11 +365,112 @@ namespace webservice{
 		/// \brief Makes sure shutdown_fn_ is called only one time
 		std::once_flag shutdown_flag_;
 
-		/// \brief Protect thread joins
+		/// \brief Protect threads_, retired_ and thread_count_
 		std::mutex mutex_;
 
 		/// \brief The worker threads
 		std::vector< std::thread > threads_;
+
+		/// \brief Threads that retired, not yet joined
+		std::vector< std::thread::id > retired_;
+
+		/// \brief Target count of threads
+		std::size_t thread_count_{0};
+
+		/// \brief Largest thread count, the concurrency hint of ioc_
+		std::size_t max_thread_count_{0};
+
+		/// \brief Count of threads of ioc_ that shall return after their
+		///        current handler
+		std::atomic< std::size_t > retire_count_{0};
+
+		/// \brief Index of the next started thread
+		std::size_t next_thread_index_{0};
+
+		/// \brief true after shutdown(), no more threads are started
+		bool is_shutdown_{false};
+
+		/// \brief Count of probes in a row with a lag below shrink_lag
+		std::size_t calm_probes_{0};
+
+		/// \brief Protects thread_counters_
+		std::mutex stats_mutex_;
+
+		/// \brief Counters of all running threads
+		std::vector< detail::thread_counters* > thread_counters_;
+
+		/// \brief Scheduling delay histogram, see executor_stats
+		std::array< std::atomic< std::uint64_t >, executor_stats::bucket_count >
+			lag_histogram_{};
+
+		/// \brief Count of probes
+		std::atomic< std::uint64_t > probes_{0};
+
+		/// \brief Last scheduling delay in microseconds
+		std::atomic< std::int64_t > last_lag_{0};
+
+		/// \brief Largest scheduling delay in microseconds
+		std::atomic< std::int64_t > max_lag_{0};
+
+		/// \brief Placement and names of the threads
+		thread_options options_;
+
+		/// \brief io_contexts that run sessions, the first one is ioc_
+		std::vector< boost::asio::io_context* > session_contexts_;
+
+		/// \brief The io_contexts of all threads that don't run ioc_
+		std::vector< std::unique_ptr< boost::asio::io_context > >
+			thread_contexts_;
+
+		/// \brief io_context of the WebSocket threads, may be nullptr
+		boost::asio::io_context* ws_context_{nullptr};
+
+		/// \brief io_context of the blocking threads, may be nullptr
+		boost::asio::io_context* blocking_context_{nullptr};
+
+		/// \brief Keep ioc_ and thread_contexts_ running until shutdown
+		std::vector< boost::asio::executor_work_guard<
+			boost::asio::io_context::executor_type > > thread_works_;
+
+		/// \brief Count of sessions per element of session_contexts_
+		std::unique_ptr< std::atomic< std::size_t >[] > session_counts_;
+
+		/// \brief Next index for round_robin placement
+		std::atomic< std::size_t > next_context_{0};
+
+		/// \brief Limits for new WebSocket sessions
+		class admission_control admission_;
+
+		/// \brief Serialized operations on probe_timer_
+		boost::asio::strand< boost::asio::io_context::executor_type >
+			probe_strand_;
+
+		/// \brief Time between two delay measurements
+		boost::asio::steady_timer probe_timer_;
+
+		/// \brief true after the first start_probe() call
+		std::atomic< bool > probe_started_{false};
+
+		/// \brief true after shutdown
+		std::atomic< bool > probe_stopped_{false};
+
+		/// \brief true if the owner of ioc_ runs it, no own threads
+		bool external_{false};
+
+		/// \brief Protects locks_released_
+		std::mutex locks_mutex_;
+
+		/// \brief Notified when locks_released_ becomes true
+		std::condition_variable locks_cv_;
+
+		/// \brief true after the last lock was released
+		bool locks_released_{false};
+
+		/// \brief Counts the async operations, see make_lock()
+		async_locker locker_;
+
+		/// \brief Keep locker_ locked until shutdown
+		async_locker::lock run_lock_;
 	};
 
 
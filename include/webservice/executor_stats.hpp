@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__executor_stats__hpp_INCLUDED_
+#define _webservice__executor_stats__hpp_INCLUDED_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace webservice{
+
+
+	/// \brief Statistics of one executor thread
+	struct executor_thread_stats{
+		/// \brief Index of the thread, as in its name
+		std::size_t index;
+
+		/// \brief Count of executed handlers
+		std::uint64_t handlers;
+
+		/// \brief Time spent in handlers that were ready when the thread
+		///        asked for work
+		std::chrono::nanoseconds busy;
+
+		/// \brief Time spent waiting for work
+		///
+		/// Includes the first handler after each wait.
+		std::chrono::nanoseconds idle;
+	};
+
+
+	/// \brief Snapshot of the statistics of an executor
+	struct executor_stats{
+		/// \brief Count of histogram buckets
+		static constexpr std::size_t bucket_count = 24;
+
+
+		/// \brief Scheduling delay of the lag probes
+		///
+		/// Bucket i counts delays in [2^i, 2^(i+1)) microseconds, the first
+		/// one also smaller and the last one also bigger delays.
+		std::array< std::uint64_t, bucket_count > lag_histogram;
+
+		/// \brief Count of lag probes
+		std::uint64_t probes;
+
+		/// \brief Scheduling delay of the last probe
+		std::chrono::microseconds last_lag;
+
+		/// \brief Largest scheduling delay of all probes
+		std::chrono::microseconds max_lag;
+
+		/// \brief Statistics of all running threads
+		std::vector< executor_thread_stats > threads;
+
+
+		/// \brief Upper bound of the quantile q (0 to 1) of the scheduling
+		///        delay
+		///
+		/// Returns the upper bound of the histogram bucket which contains
+		/// the quantile, 0 if there were no probes.
+		std::chrono::microseconds lag_quantile(double q)const noexcept;
+
+		/// \brief Histogram bucket of a scheduling delay
+		static std::size_t lag_bucket(std::chrono::microseconds lag)noexcept;
+	};
+
+
+	namespace detail{
+
+
+		/// \brief Counters of one executor thread
+		///
+		/// Written by its thread only, read by executor::stats().
+		struct thread_counters{
+			explicit thread_counters(std::size_t index)noexcept
+				: index(index) {}
+
+			/// \brief Index of the thread
+			std::size_t const index;
+
+			/// \brief Count of executed handlers
+			std::atomic< std::uint64_t > handlers{0};
+
+			/// \brief Nanoseconds in ready handlers
+			std::atomic< std::uint64_t > busy{0};
+
+			/// \brief Nanoseconds waiting for work
+			std::atomic< std::uint64_t > idle{0};
+		};
+
+
+	}
+
+
+}
+
+
+#endif
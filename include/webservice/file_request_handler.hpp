@@ -23,6 +23,10 @@ namespace webservice{
 		file_request_handler(std::string doc_root)
 			: doc_root_(std::move(doc_root)) {}
 
+		/// \brief Send the requested file
+		///
+		/// The file is opened on the blocking threads of the executor if
+		/// there are any, see thread_options::blocking_threads.
 		void operator()(http_request&& req, http_response&& send)override;
 
 
@@ -57,6 +61,10 @@ namespace webservice{
 
 
 	private:
+		/// \brief Open the file and send it or an error response
+		void open_and_send(http_request&& req, http_response&& send);
+
+
 		std::string doc_root_;
 	};
 
@@ -0,0 +1,250 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__fixed_message__hpp_INCLUDED_
+#define _webservice__fixed_message__hpp_INCLUDED_
+
+#include "message_builder.hpp"
+
+#include <boost/endian/conversion.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+
+namespace webservice{
+
+
+	namespace detail{
+
+
+		/// \brief Unsigned integer with the size of T
+		template < std::size_t Size >
+		struct wire_uint;
+
+		template <> struct wire_uint< 1 >{ using type = std::uint8_t; };
+		template <> struct wire_uint< 2 >{ using type = std::uint16_t; };
+		template <> struct wire_uint< 4 >{ using type = std::uint32_t; };
+		template <> struct wire_uint< 8 >{ using type = std::uint64_t; };
+
+
+		/// \brief Read a little endian T from unaligned memory
+		template < typename T >
+		T load_little(unsigned char const* data)noexcept{
+			static_assert(std::is_arithmetic< T >::value,
+				"T must be an arithmetic type");
+
+			using uint = typename wire_uint< sizeof(T) >::type;
+			uint raw;
+			std::memcpy(&raw, data, sizeof(raw));
+			boost::endian::little_to_native_inplace(raw);
+
+			T result;
+			std::memcpy(&result, &raw, sizeof(result));
+			return result;
+		}
+
+		/// \brief Read a little endian bool from unaligned memory
+		template <>
+		inline bool load_little< bool >(unsigned char const* data)noexcept{
+			return *data != 0;
+		}
+
+		/// \brief Write T little endian to unaligned memory
+		template < typename T >
+		void store_little(unsigned char* data, T value)noexcept{
+			static_assert(std::is_arithmetic< T >::value,
+				"T must be an arithmetic type");
+
+			using uint = typename wire_uint< sizeof(T) >::type;
+			uint raw;
+			std::memcpy(&raw, &value, sizeof(raw));
+			boost::endian::native_to_little_inplace(raw);
+			std::memcpy(data, &raw, sizeof(raw));
+		}
+
+		/// \brief Write a bool as single byte
+		template <>
+		inline void store_little< bool >(unsigned char* data, bool value)
+		noexcept{
+			*data = value ? 1 : 0;
+		}
+
+
+	}
+
+
+	/// \brief Read only access to a received message of Size bytes
+	///
+	/// Base of the views generated by webservice_generate_messages(). Takes
+	/// ownership of the received buffer and reads the fields in place. A
+	/// message that was received in more than one segment is copied once
+	/// into the view itself, so no allocation happens in any case.
+	template < std::size_t Size >
+	class fixed_message_view{
+	public:
+		/// \brief Count of bytes in the message
+		static constexpr std::size_t wire_size = Size;
+
+
+		/// \brief View on buffer
+		///
+		/// \throw std::runtime_error if the size of buffer is not Size
+		explicit fixed_message_view(boost::beast::multi_buffer&& buffer)
+			: buffer_(std::move(buffer))
+		{
+			auto const buffers = buffer_.data();
+			auto const size = boost::asio::buffer_size(buffers);
+			if(size != Size){
+				throw std::runtime_error("message size " +
+					std::to_string(size) + " does not match the expected "
+					"size " + std::to_string(Size));
+			}
+
+			auto const begin = boost::asio::buffer_sequence_begin(buffers);
+			if(std::next(begin) == boost::asio::buffer_sequence_end(buffers)){
+				data_ = static_cast< unsigned char const* >(
+					boost::asio::const_buffer(*begin).data());
+			}else{
+				boost::asio::buffer_copy(
+					boost::asio::buffer(copy_), buffers);
+				data_ = copy_.data();
+			}
+		}
+
+		fixed_message_view(fixed_message_view&& other)noexcept
+			: buffer_(std::move(other.buffer_))
+			, copy_(other.copy_)
+			, data_(other.is_copy() ? copy_.data() : other.data_) {}
+
+		fixed_message_view& operator=(fixed_message_view&& other)noexcept{
+			buffer_ = std::move(other.buffer_);
+			copy_ = other.copy_;
+			data_ = other.is_copy() ? copy_.data() : other.data_;
+			return *this;
+		}
+
+
+		/// \brief The message bytes
+		unsigned char const* data()const noexcept{
+			return data_;
+		}
+
+
+	protected:
+		/// \brief Read a field at offset
+		template < typename T >
+		T load(std::size_t offset)const noexcept{
+			return detail::load_little< T >(data_ + offset);
+		}
+
+		/// \brief Read a character field of size bytes at offset
+		///
+		/// The text ends at the first null character.
+		boost::string_view load_text(std::size_t offset, std::size_t size)
+		const noexcept{
+			auto const text = reinterpret_cast< char const* >(data_ + offset);
+			auto const end = static_cast< char const* >(
+				std::memchr(text, '\0', size));
+			return boost::string_view(text,
+				end ? static_cast< std::size_t >(end - text) : size);
+		}
+
+
+	private:
+		/// \brief true if data_ points to copy_
+		bool is_copy()const noexcept{
+			return data_ == copy_.data();
+		}
+
+
+		/// \brief The received message
+		boost::beast::multi_buffer buffer_;
+
+		/// \brief The message if it was received in segments
+		std::array< unsigned char, Size > copy_;
+
+		/// \brief The message bytes
+		unsigned char const* data_;
+	};
+
+	template < std::size_t Size >
+	constexpr std::size_t fixed_message_view< Size >::wire_size;
+
+
+	/// \brief Build a message of Size bytes in pooled storage
+	///
+	/// Base of the builders generated by webservice_generate_messages().
+	/// All fields are zero initialized.
+	template < std::size_t Size >
+	class fixed_message_builder{
+	public:
+		/// \brief Count of bytes in the message
+		static constexpr std::size_t wire_size = Size;
+
+
+		/// \brief Message with all bytes zero
+		fixed_message_builder()
+			: data_(builder_.grow_by(Size))
+		{
+			std::memset(data_, 0, Size);
+		}
+
+
+		/// \brief Move the message into a shared_const_buffer
+		///
+		/// The builder must not be used afterwards.
+		shared_const_buffer freeze(){
+			data_ = nullptr;
+			return builder_.freeze();
+		}
+
+
+	protected:
+		/// \brief Write a field at offset
+		template < typename T >
+		void store(std::size_t offset, T value)noexcept{
+			detail::store_little(data_ + offset, value);
+		}
+
+		/// \brief Write a character field of size bytes at offset
+		///
+		/// Longer text is truncated, shorter text is padded with null
+		/// characters.
+		void store_text(
+			std::size_t offset,
+			std::size_t size,
+			boost::string_view text
+		)noexcept{
+			auto const count = text.size() < size ? text.size() : size;
+			std::memcpy(data_ + offset, text.data(), count);
+			std::memset(data_ + offset + count, 0, size - count);
+		}
+
+
+	private:
+		/// \brief The pooled storage
+		message_builder builder_;
+
+		/// \brief The message bytes
+		unsigned char* data_;
+	};
+
+	template < std::size_t Size >
+	constexpr std::size_t fixed_message_builder< Size >::wire_size;
+
+
+}
+
+
+#endif
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__handler_allocator__hpp_INCLUDED_
+#define _webservice__handler_allocator__hpp_INCLUDED_
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/bind_executor.hpp>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+
+namespace webservice{
+
+
+	namespace detail{
+
+
+		/// \brief Get at least size bytes from the free lists of this
+		///        thread
+		void* handler_allocate(std::size_t size);
+
+		/// \brief Return memory of size bytes to the free lists of the
+		///        thread that allocated it
+		void handler_deallocate(void* pointer, std::size_t size)noexcept;
+
+		/// \brief Usable bytes of the memory that handler_allocate(size)
+		///        returns, at least size
+		std::size_t handler_block_size(std::size_t size)noexcept;
+
+
+	}
+
+
+	/// \brief Allocator that recycles memory in thread local free lists
+	///
+	/// Used for the handlers of all internal asynchronous operations and
+	/// strand calls, for message storage and for coroutine frames. Blocks
+	/// up to 1 MiB are kept in free lists per size class, so steady state
+	/// message processing does not call operator new. Memory that is
+	/// deallocated by another thread goes back to the thread that allocated
+	/// it, so a thread that produces messages for other threads reuses its
+	/// own blocks. Stateless, all instances compare equal.
+	template < typename T >
+	class recycling_allocator{
+	public:
+		using value_type = T;
+
+		recycling_allocator()noexcept = default;
+
+		template < typename U >
+		recycling_allocator(recycling_allocator< U > const&)noexcept{}
+
+
+		T* allocate(std::size_t n){
+			return static_cast< T* >(detail::handler_allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* pointer, std::size_t n)noexcept{
+			detail::handler_deallocate(pointer, n * sizeof(T));
+		}
+	};
+
+	template < typename T, typename U >
+	bool operator==(
+		recycling_allocator< T > const&,
+		recycling_allocator< U > const&
+	)noexcept{
+		return true;
+	}
+
+	template < typename T, typename U >
+	bool operator!=(
+		recycling_allocator< T > const&,
+		recycling_allocator< U > const&
+	)noexcept{
+		return false;
+	}
+
+
+	/// \brief Handler with recycling_allocator as associated allocator
+	template < typename Handler >
+	class recycling_handler{
+	public:
+		explicit recycling_handler(Handler handler)
+			: handler_(std::move(handler)) {}
+
+		template < typename ... Args >
+		auto operator()(Args&& ... args)
+			-> decltype(std::declval< Handler& >()(
+				static_cast< Args&& >(args) ...))
+		{
+			return handler_(static_cast< Args&& >(args) ...);
+		}
+
+
+	private:
+		Handler handler_;
+	};
+
+	/// \brief Associate handler with recycling_allocator
+	template < typename Handler >
+	recycling_handler< std::decay_t< Handler > > bind_recycling_allocator(
+		Handler&& handler
+	){
+		return recycling_handler< std::decay_t< Handler > >(
+			static_cast< Handler&& >(handler));
+	}
+
+	/// \brief Associate handler with executor and recycling_allocator
+	template < typename Executor, typename Handler >
+	auto bind_recycling(Executor const& executor, Handler&& handler){
+		return boost::asio::bind_executor(executor,
+			bind_recycling_allocator(static_cast< Handler&& >(handler)));
+	}
+
+
+}
+
+
+namespace boost{ namespace asio{
+
+
+	template < typename Handler, typename Allocator >
+	struct associated_allocator<
+		webservice::recycling_handler< Handler >, Allocator >
+	{
+		using type = webservice::recycling_allocator< void >;
+
+		static type get(
+			webservice::recycling_handler< Handler > const&,
+			Allocator const& = Allocator()
+		)noexcept{
+			return type();
+		}
+	};
+
+
+} }
+
+
+#endif
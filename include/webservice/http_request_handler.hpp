@@ -85,6 +85,11 @@ namespace webservice{
 		/// \throw std::logic_error if handler is not owned by a server
 		class server& server();
 
+		/// \brief Get reference to the executor of the server
+		///
+		/// \throw std::logic_error if handler is not owned by a server
+		class executor& executor();
+
 
 	private:
 		/// \brief Session is closed after this time without receiving
@@ -112,6 +117,13 @@ namespace webservice{
 		boost::beast::string_view what
 	);
 
+	/// \brief Returns a service unavailable response that closes the
+	///        connection
+	http_string_response service_unavailable(
+		http_request const& req,
+		std::chrono::seconds retry_after
+	);
+
 
 }
 
@@ -10,13 +10,13 @@
 #define _webservice__http_response__hpp_INCLUDED_
 
 #include "async_locker.hpp"
+#include "handler_allocator.hpp"
 
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/write.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
-#include <boost/asio/bind_executor.hpp>
 
 #include <memory>
 
@@ -54,10 +54,16 @@ namespace webservice{
 		virtual void operator()() = 0;
 	};
 
+	/// \brief Sends the response to one request
+	///
+	/// Keeps the session alive until it is called, so the response may be
+	/// sent later from any thread. Responses are sent in the order of
+	/// their requests. Call it exactly once. If it is destroyed without a
+	/// call, it sends a 500 response and closes the session.
 	class http_response{
 	public:
-		using response_fn =
-			void (http_session::*)(std::unique_ptr< http_session_work >&&);
+		using response_fn = void (http_session::*)(
+			std::size_t, std::unique_ptr< http_session_work >&&);
 
 		http_response(
 			class http_session* self,
@@ -65,13 +71,21 @@ namespace webservice{
 			response_fn fn,
 			boost::asio::ip::tcp::socket& socket,
 			boost::asio::strand<
-				boost::asio::io_context::executor_type >& strand
+				boost::asio::io_context::executor_type >& strand,
+			std::size_t slot
 		)
 			: self_(self)
 			, locker_(locker)
+			, lock_(locker.make_lock())
 			, fn_(fn)
 			, socket_(socket)
-			, strand_(strand) {}
+			, strand_(strand)
+			, slot_(slot) {}
+
+		http_response(http_response&&) = default;
+
+		/// \brief Answer with an error if no response was sent
+		~http_response();
 
 		// Called by the HTTP handler to send a response.
 		template < typename Body, typename Fields >
@@ -99,7 +113,7 @@ namespace webservice{
 					boost::beast::http::async_write(
 						socket_,
 						msg_,
-						boost::asio::bind_executor(
+						bind_recycling(
 							strand_,
 							http_session_on_write(
 								self_, locker_.make_lock(), msg_.need_eof())
@@ -115,16 +129,28 @@ namespace webservice{
 				boost::beast::http::response< Body, Fields > msg_;
 			};
 
-			((*self_).*fn_)(std::make_unique< work_impl >(
-				self_, locker_, socket_, strand_, std::move(msg)));
+			// Runs inline if called on the session strand
+			strand_.dispatch(
+				[
+					self = self_,
+					fn = fn_,
+					slot = slot_,
+					lock = std::move(lock_),
+					work = std::make_unique< work_impl >(
+						self_, locker_, socket_, strand_, std::move(msg))
+				]()mutable{
+					((*self).*fn)(slot, std::move(work));
+				}, recycling_allocator< void >());
 		}
 
 	private:
 		class http_session* self_;
 		async_locker& locker_;
+		async_locker::lock lock_;
 		response_fn fn_;
 		boost::asio::ip::tcp::socket& socket_;
 		boost::asio::strand< boost::asio::io_context::executor_type >& strand_;
+		std::size_t slot_;
 	};
 
 
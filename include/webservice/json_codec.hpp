@@ -0,0 +1,156 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__json_codec__hpp_INCLUDED_
+#define _webservice__json_codec__hpp_INCLUDED_
+
+#include "json_conversion.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstdint>
+
+
+namespace webservice{
+
+
+	/// \brief Wire format of a JSON message
+	enum class json_codec{
+		/// \brief Textual JSON, sent as text message
+		json,
+
+		/// \brief CBOR (RFC 7049), sent as binary message
+		cbor,
+
+		/// \brief MessagePack, sent as binary message
+		msgpack,
+
+		/// \brief UBJSON, sent as binary message
+		ubjson
+	};
+
+
+	/// \brief WebSocket subprotocol name of codec
+	inline char const* to_subprotocol(json_codec codec)noexcept{
+		switch(codec){
+			case json_codec::json: return "json";
+			case json_codec::cbor: return "cbor";
+			case json_codec::msgpack: return "msgpack";
+			case json_codec::ubjson: return "ubjson";
+		}
+		return "json";
+	}
+
+	/// \brief Codec of a WebSocket subprotocol name, json if unknown
+	inline json_codec json_codec_from_subprotocol(
+		boost::string_view protocol
+	)noexcept{
+		if(protocol == "cbor") return json_codec::cbor;
+		if(protocol == "msgpack") return json_codec::msgpack;
+		if(protocol == "ubjson") return json_codec::ubjson;
+		return json_codec::json;
+	}
+
+
+	/// \brief Encode data in codec into pooled storage
+	inline shared_const_buffer encode_json(
+		nlohmann::json const& data,
+		json_codec codec
+	){
+		if(codec == json_codec::json){
+			return to_shared_const_buffer_t< nlohmann::json >{}(data);
+		}
+
+		message_builder builder(256);
+		auto& os = detail::json_builder_stream::get(builder);
+
+		try{
+			switch(codec){
+				case json_codec::json: break;
+				case json_codec::cbor: nlohmann::json::to_cbor(data, os); break;
+				case json_codec::msgpack:
+					nlohmann::json::to_msgpack(data, os);
+				break;
+				case json_codec::ubjson:
+					nlohmann::json::to_ubjson(data, os);
+				break;
+			}
+		}catch(nlohmann::json::exception const& e){
+			throw std::runtime_error(std::string(e.what()) + "; "
+				+ to_subprotocol(codec) + " encoding failed");
+		}
+
+		return builder.freeze();
+	}
+
+	/// \brief Decode a message in codec
+	inline nlohmann::json decode_json(
+		boost::beast::multi_buffer const& buffer,
+		json_codec codec
+	){
+		if(codec == json_codec::json){
+			return from_multi_buffer_t< nlohmann::json >{}(buffer);
+		}
+
+		try{
+			return detail::parse_multi_buffer(buffer,
+				[codec](auto first, auto last){
+					switch(codec){
+						case json_codec::json: break;
+						case json_codec::cbor:
+							return nlohmann::json::from_cbor(first, last);
+						case json_codec::msgpack:
+							return nlohmann::json::from_msgpack(first, last);
+						case json_codec::ubjson:
+							return nlohmann::json::from_ubjson(first, last);
+					}
+					return nlohmann::json();
+				});
+		}catch(nlohmann::json::exception const& e){
+			throw std::runtime_error(std::string(e.what()) + "; "
+				+ to_subprotocol(codec) + " decoding failed");
+		}
+	}
+
+
+	/// \brief JSON data that is sent and received in a binary codec
+	///
+	/// Use cbor_json, msgpack_json or ubjson_json as binary type of a
+	/// basic_ws_service to exchange binary encoded JSON messages.
+	template < json_codec Codec >
+	struct binary_json{
+		/// \brief The JSON data
+		nlohmann::json value;
+	};
+
+	using cbor_json = binary_json< json_codec::cbor >;
+	using msgpack_json = binary_json< json_codec::msgpack >;
+	using ubjson_json = binary_json< json_codec::ubjson >;
+
+
+	template < json_codec Codec >
+	struct to_shared_const_buffer_t< binary_json< Codec > >{
+		shared_const_buffer operator()(binary_json< Codec > const& data)const{
+			return encode_json(data.value, Codec);
+		}
+	};
+
+	template < json_codec Codec >
+	struct from_multi_buffer_t< binary_json< Codec > >{
+		binary_json< Codec > operator()(
+			boost::beast::multi_buffer const& buffer
+		)const{
+			return {decode_json(buffer, Codec)};
+		}
+	};
+
+
+}
+
+
+#endif
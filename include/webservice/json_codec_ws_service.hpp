@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__json_codec_ws_service__hpp_INCLUDED_
+#define _webservice__json_codec_ws_service__hpp_INCLUDED_
+
+#include "json_codec.hpp"
+#include "basic_ws_service.hpp"
+
+#include <boost/optional.hpp>
+
+#include <array>
+
+
+namespace webservice{
+
+
+	/// \brief JSON service with a wire codec per session
+	///
+	/// The codec is selected by the negotiated WebSocket subprotocol
+	/// ("cbor", "msgpack", "ubjson" or "json"). Sessions without a
+	/// subprotocol, e.g. browsers, use textual JSON. Binary codecs are sent
+	/// as binary messages. Use set_subprotocols() to change the supported
+	/// codecs or their preference.
+	template < typename Value >
+	class basic_json_codec_ws_service: public ws_service_base< Value >{
+	public:
+		/// \brief Support all codecs, binary ones preferred
+		basic_json_codec_ws_service(){
+			this->set_subprotocols({"cbor", "msgpack", "ubjson", "json"});
+		}
+
+
+		/// \brief Codec of a session
+		///
+		/// Must only be called while the session exists, see subprotocol().
+		static json_codec codec(ws_identifier identifier)noexcept{
+			return json_codec_from_subprotocol(
+				ws_service_base< Value >::subprotocol(identifier));
+		}
+
+
+		/// \brief Send data to all sessions, each in its codec
+		///
+		/// data is encoded on the service strand once per codec in use.
+		void send_json(nlohmann::json data){
+			using cache_type =
+				std::array< boost::optional< shared_const_buffer >, 4 >;
+
+			this->send_encoded(
+				[data = std::move(data), cache = cache_type()](
+					ws_identifier identifier
+				)mutable{
+					auto const session_codec = codec(identifier);
+					auto& buffer =
+						cache[static_cast< std::size_t >(session_codec)];
+					if(!buffer){
+						buffer = encode_json(data, session_codec);
+					}
+					return std::make_pair(*buffer,
+						session_codec == json_codec::json);
+				});
+		}
+
+		/// \brief Send data to session in its codec
+		void send_json(ws_identifier identifier, nlohmann::json data){
+			this->send_encoded(identifier,
+				[data = std::move(data)](ws_identifier identifier){
+					auto const session_codec = codec(identifier);
+					return std::make_pair(encode_json(data, session_codec),
+						session_codec == json_codec::json);
+				});
+		}
+
+
+	private:
+		/// \brief Called when a session received a message
+		///
+		/// Default implementation does nothing.
+		virtual void on_json(
+			ws_identifier /*identifier*/,
+			nlohmann::json&& /*data*/){}
+
+
+		/// \brief Decode textual JSON
+		void on_text(
+			ws_identifier identifier,
+			boost::beast::multi_buffer&& buffer
+		)final{
+			try{
+				on_json(identifier, decode_json(buffer, json_codec::json));
+			}catch(...){
+				this->on_exception(identifier, std::current_exception());
+			}
+		}
+
+		/// \brief Decode with the codec of the session
+		void on_binary(
+			ws_identifier identifier,
+			boost::beast::multi_buffer&& buffer
+		)final{
+			try{
+				auto const session_codec = codec(identifier);
+				if(session_codec == json_codec::json){
+					throw std::runtime_error(
+						"binary message in textual JSON session");
+				}
+
+				on_json(identifier, decode_json(buffer, session_codec));
+			}catch(...){
+				this->on_exception(identifier, std::current_exception());
+			}
+		}
+	};
+
+
+	class json_codec_ws_service
+		: public basic_json_codec_ws_service< none_t >
+	{
+		using basic_json_codec_ws_service::basic_json_codec_ws_service;
+
+		/// \brief Create a new ws_session
+		void on_server_connect(
+			boost::asio::ip::tcp::socket&& socket,
+			http_request&& req
+		){
+			async_server_connect(std::move(socket), std::move(req));
+		}
+
+		/// \brief Create a new client websocket session
+		void on_client_connect(
+			std::string&& host,
+			std::string&& port,
+			std::string&& resource
+		){
+			async_client_connect(std::move(host), std::move(port),
+				std::move(resource));
+		}
+	};
+
+
+}
+
+
+#endif
@@ -10,38 +10,346 @@
 #define _webservice__json_conversion__hpp_INCLUDED_
 
 #include "conversion.hpp"
+#include "message_builder.hpp"
+
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
 
 namespace webservice{
 
 
+	namespace detail{
+
+
+		/// \brief Stream buffer that appends to a message_builder
+		class json_builder_buf: public std::streambuf{
+		public:
+			/// \brief Target of the current serialization
+			message_builder* builder = nullptr;
+
+
+		protected:
+			int_type overflow(int_type c)override{
+				if(!traits_type::eq_int_type(c, traits_type::eof())){
+					builder->push_back(traits_type::to_char_type(c));
+				}
+				return traits_type::not_eof(c);
+			}
+
+			std::streamsize xsputn(char const* s, std::streamsize n)override{
+				builder->append(s, static_cast< std::size_t >(n));
+				return n;
+			}
+		};
+
+		/// \brief Output stream into a message_builder
+		///
+		/// nlohmann::json serializes into any std::ostream by its public
+		/// interface, this avoids an intermediate std::string.
+		class json_builder_stream{
+		public:
+			json_builder_stream()
+				: os_(&buf_)
+			{
+				os_.exceptions(std::ios::badbit);
+			}
+
+			json_builder_stream(json_builder_stream const&) = delete;
+
+			json_builder_stream& operator=(json_builder_stream const&)
+				= delete;
+
+
+			/// \brief The stream of this thread, writing into builder
+			static std::ostream& get(message_builder& builder){
+				static thread_local json_builder_stream stream;
+				stream.buf_.builder = &builder;
+				stream.os_.clear();
+				return stream.os_;
+			}
+
+
+		private:
+			json_builder_buf buf_;
+			std::ostream os_;
+		};
+
+
+		/// \brief Call parse(first, last) with an iterator range over buffer
+		///
+		/// The range is a pointer range into the message if it is contiguous.
+		template < typename Parse >
+		nlohmann::json parse_multi_buffer(
+			boost::beast::multi_buffer const& buffer,
+			Parse&& parse
+		){
+			auto const data = buffer.data();
+			auto const begin = boost::asio::buffer_sequence_begin(data);
+			auto const end = boost::asio::buffer_sequence_end(data);
+			if(begin != end && std::next(begin) == end){
+				boost::asio::const_buffer const segment(*begin);
+				auto const first = static_cast< char const* >(segment.data());
+				return parse(first, first + segment.size());
+			}
+
+#if NLOHMANN_JSON_VERSION_MAJOR > 3 || \
+	(NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR >= 9)
+			return parse(
+				boost::asio::buffers_begin(data),
+				boost::asio::buffers_end(data));
+#else
+			// Older versions of nlohmann::json only parse contiguous ranges
+			constexpr from_multi_buffer_t< std::string > to_string;
+			auto const copy = to_string(buffer);
+			return parse(copy.data(), copy.data() + copy.size());
+#endif
+		}
+
+
+		/// \brief Serialize data into pooled storage
+		///
+		/// The storage is presized by a moving average of the previous
+		/// message sizes of this thread.
+		inline shared_const_buffer dump_json(nlohmann::json const& data){
+			static thread_local std::size_t estimate = 256;
+
+			message_builder builder(estimate + estimate / 4);
+			json_builder_stream::get(builder) << data;
+
+			estimate = (estimate * 7 + builder.size()) / 8;
+			return builder.freeze();
+		}
+
+
+	}
+
+
+	/// \brief Already serialized JSON that is embedded verbatim
+	///
+	/// Use it for big sub documents that rarely change, see spliced_json.
+	class json_fragment{
+	public:
+		/// \brief Serialize value once
+		explicit json_fragment(nlohmann::json const& value);
+
+		/// \brief Use serialized JSON text as it is, it is not validated
+		explicit json_fragment(shared_const_buffer serialized)noexcept
+			: buffer_(std::move(serialized)) {}
+
+
+		/// \brief The serialized JSON
+		shared_const_buffer const& buffer()const noexcept{
+			return buffer_;
+		}
+
+
+	private:
+		/// \brief The serialized JSON
+		shared_const_buffer buffer_;
+	};
+
+
+	/// \brief JSON message with embedded json_fragment objects
+	///
+	/// Assign the placeholders returned by embed() anywhere as values in
+	/// value. When the message is serialized, the placeholders are replaced
+	/// by the fragments, which become segments of the message without being
+	/// copied. Placeholders must not be used as object keys and the message
+	/// must not contain strings equal to a placeholder otherwise.
+	///
+	/// Send it as text type of a basic_json_ws_service.
+	class spliced_json{
+	public:
+		/// \brief Empty message
+		spliced_json() = default;
+
+		/// \brief Message with value
+		explicit spliced_json(nlohmann::json value)
+			: value(std::move(value)) {}
+
+
+		/// \brief Placeholder value for fragment
+		nlohmann::json embed(json_fragment fragment){
+			// begin of a placeholder, followed by index and a null
+			static constexpr char prefix[] = "\0webservice_fragment:";
+
+			auto placeholder = std::string(prefix, sizeof(prefix) - 1);
+			placeholder += std::to_string(fragments_.size());
+			placeholder += '\0';
+			fragments_.push_back(std::move(fragment));
+			return placeholder;
+		}
+
+		/// \brief Fragments in order of embed() calls
+		std::vector< json_fragment > const& fragments()const noexcept{
+			return fragments_;
+		}
+
+
+		/// \brief The message, contains the placeholders
+		nlohmann::json value;
+
+
+	private:
+		/// \brief The embedded fragments
+		std::vector< json_fragment > fragments_;
+	};
+
+
 	template <>
 	struct to_shared_const_buffer_t< nlohmann::json >{
 		shared_const_buffer operator()(nlohmann::json const& data)const{
 			try{
-				return shared_const_buffer(data.dump());
+				return detail::dump_json(data);
 			}catch(nlohmann::json::exception const& e){
 				throw std::runtime_error(std::string(e.what())
 					+ "; dump failed");
 			}
 		}
+
+		/// \brief Serialize the message and splice in the fragments
+		shared_const_buffer operator()(spliced_json const& data)const{
+			auto const envelope = (*this)(data.value);
+			auto const& fragments = data.fragments();
+			if(fragments.empty()){
+				return envelope;
+			}
+
+			// serialized form of the placeholder begin and end
+			boost::string_view const prefix = "\"\\u0000webservice_fragment:";
+			boost::string_view const suffix = "\\u0000\"";
+
+			boost::string_view const text(
+				static_cast< char const* >(envelope.begin()->data()),
+				envelope.size());
+
+			std::vector< shared_const_buffer > segments;
+			std::size_t start = 0;
+			for(
+				auto pos = text.find(prefix);
+				pos != boost::string_view::npos;
+				pos = text.find(prefix, pos + 1)
+			){
+				// an escaped quote inside of a string
+				if(pos > 0 && text[pos - 1] == '\\'){
+					continue;
+				}
+
+				auto const number = pos + prefix.size();
+				auto const end = text.find(suffix, number);
+				std::size_t index;
+				if(
+					end == boost::string_view::npos ||
+					!parse_index(text.substr(number, end - number), index) ||
+					index >= fragments.size()
+				){
+					continue;
+				}
+
+				if(pos > start){
+					segments.push_back(envelope.slice(start, pos - start));
+				}
+				segments.push_back(fragments[index].buffer());
+				start = end + suffix.size();
+			}
+
+			if(segments.empty()){
+				return envelope;
+			}
+			if(start < text.size()){
+				segments.push_back(
+					envelope.slice(start, text.size() - start));
+			}
+			return shared_const_buffer(std::move(segments));
+		}
+
+
+	private:
+		/// \brief Parse a placeholder index
+		static bool parse_index(boost::string_view text, std::size_t& index){
+			if(text.empty() || text.size() > 9){
+				return false;
+			}
+			index = 0;
+			for(auto const c: text){
+				if(c < '0' || c > '9'){
+					return false;
+				}
+				index = index * 10 + static_cast< std::size_t >(c - '0');
+			}
+			return true;
+		}
 	};
 
+
+	inline json_fragment::json_fragment(nlohmann::json const& value)
+		: buffer_(to_shared_const_buffer_t< nlohmann::json >{}(value)) {}
+
 	template <>
 	struct from_multi_buffer_t< nlohmann::json >{
 		nlohmann::json operator()(
 			boost::beast::multi_buffer const& buffer
 		)const{
-			constexpr from_multi_buffer_t< std::string > to_string;
-			auto data = to_string(buffer);
+			auto const data = buffer.data();
 			try{
-				return nlohmann::json::parse(data);
+				return parse(buffer);
+			}catch(nlohmann::json::parse_error const& e){
+				throw std::runtime_error(std::string(e.what())
+					+ "; parsed expression excerpt '"
+					+ excerpt(data, e.byte) + "'");
 			}catch(nlohmann::json::exception const& e){
 				throw std::runtime_error(std::string(e.what())
-					+ "; parsed expression '" + data + "'");
+					+ "; parsed expression excerpt '"
+					+ excerpt(data, 0) + "'");
+			}
+		}
+
+
+	private:
+		using buffers_type = boost::beast::multi_buffer::const_buffers_type;
+
+		/// \brief Parse without copying the message
+		static nlohmann::json parse(boost::beast::multi_buffer const& buffer){
+			return detail::parse_multi_buffer(buffer,
+				[](auto first, auto last){
+					return nlohmann::json::parse(first, last);
+				});
+		}
+
+		/// \brief At most 64 bytes of data around position
+		static std::string excerpt(
+			buffers_type const& data,
+			std::size_t position
+		){
+			constexpr std::size_t excerpt_size = 64;
+
+			auto const size = boost::asio::buffer_size(data);
+			auto const first = std::min(
+				position > excerpt_size / 2 ? position - excerpt_size / 2 : 0,
+				size > excerpt_size ? size - excerpt_size : 0);
+			auto const last = std::min(size, first + excerpt_size);
+
+			std::string result;
+			if(first > 0){
+				result += "...";
+			}
+			auto const begin = boost::asio::buffers_begin(data);
+			result.append(begin + first, begin + last);
+			if(last < size){
+				result += "...";
 			}
+			return result;
 		}
 	};
 
@@ -10,6 +10,7 @@
 #define _webservice__json_ws_service__hpp_INCLUDED_
 
 #include "json_conversion.hpp"
+#include "lazy_json.hpp"
 #include "basic_ws_service.hpp"
 
 
@@ -28,6 +29,28 @@ namespace webservice{
 			nlohmann::json, ReceiveBinaryType >::basic_ws_service;
 	};
 
+	/// \brief JSON service that decodes received text messages on access
+	///
+	/// Handlers receive a lazy_json, see there. Sending is equal to
+	/// basic_json_ws_service.
+	template <
+		typename Value,
+		typename SendBinaryType,
+		typename ReceiveBinaryType = SendBinaryType >
+	class basic_lazy_json_ws_service
+		: public basic_ws_service< Value,
+			nlohmann::json, SendBinaryType, lazy_json, ReceiveBinaryType >
+	{
+		using basic_ws_service< Value, nlohmann::json, SendBinaryType,
+			lazy_json, ReceiveBinaryType >::basic_ws_service;
+	};
+
+	/// \brief Decode a lazy_json value completely
+	inline nlohmann::json materialize(lazy_json_value const& value){
+		auto const text = value.raw();
+		return nlohmann::json::parse(text.begin(), text.end());
+	}
+
 	class json_ws_service
 		: public basic_json_ws_service< none_t, std::vector< std::uint8_t > >
 	{
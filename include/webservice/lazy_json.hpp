@@ -0,0 +1,296 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__lazy_json__hpp_INCLUDED_
+#define _webservice__lazy_json__hpp_INCLUDED_
+
+#include "conversion.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace webservice{
+
+
+	/// \brief Type of a JSON value
+	enum class lazy_json_type: std::uint8_t{
+		null,
+		boolean,
+		number,
+		string,
+		array,
+		object
+	};
+
+
+	class lazy_json;
+
+
+	namespace detail{
+
+
+		/// \brief Index entry of one JSON value or object key
+		struct lazy_json_token{
+			/// \brief Offset of the first byte
+			std::uint32_t begin;
+
+			/// \brief Offset behind the last byte
+			std::uint32_t end;
+
+			/// \brief Index of the token behind this value and its children
+			std::uint32_t next;
+
+			/// \brief Count of elements or members of arrays and objects
+			std::uint32_t count;
+
+			/// \brief Type of the value
+			lazy_json_type type;
+
+			/// \brief true if the string contains escape sequences
+			bool escaped;
+		};
+
+
+	}
+
+
+	/// \brief A value inside a lazy_json document
+	///
+	/// Cheap to copy. Valid as long as the document exists and was not
+	/// moved. A default constructed value represents a missing value.
+	class lazy_json_value{
+	public:
+		/// \brief Missing value
+		lazy_json_value()noexcept = default;
+
+
+		/// \brief false if the value is missing
+		explicit operator bool()const noexcept{
+			return document_ != nullptr;
+		}
+
+		/// \brief Type of the value
+		///
+		/// \throw std::out_of_range if the value is missing
+		lazy_json_type type()const;
+
+		/// \brief The JSON text of the value
+		///
+		/// \throw std::out_of_range if the value is missing
+		boost::string_view raw()const;
+
+
+		/// \brief Count of elements of an array or members of an object
+		///
+		/// \throw std::runtime_error if the value is no array or object
+		std::size_t size()const;
+
+		/// \brief Member key, missing value if not found or no object
+		lazy_json_value find(boost::string_view key)const noexcept;
+
+		/// \brief Member key
+		///
+		/// \throw std::out_of_range if not found or no object
+		lazy_json_value at(boost::string_view key)const;
+
+		/// \brief Element index
+		///
+		/// \throw std::out_of_range if out of range or no array
+		lazy_json_value at(std::size_t index)const;
+
+		/// \brief Call fn(key, value) for all members of an object
+		///
+		/// \throw std::runtime_error if the value is no object
+		template < typename Fn >
+		void for_each_member(Fn&& fn)const;
+
+		/// \brief Call fn(value) for all elements of an array
+		///
+		/// \throw std::runtime_error if the value is no array
+		template < typename Fn >
+		void for_each_element(Fn&& fn)const;
+
+
+		/// \brief true if the value is null
+		bool is_null()const{
+			return type() == lazy_json_type::null;
+		}
+
+		/// \brief The value of a boolean
+		///
+		/// \throw std::runtime_error if the value is no boolean
+		bool get_bool()const;
+
+		/// \brief The value of an integral number
+		///
+		/// \throw std::runtime_error if the value is no integral number or
+		///                           out of range
+		std::int64_t get_int64()const;
+
+		/// \brief The value of a non negative integral number
+		///
+		/// \throw std::runtime_error if the value is no integral number or
+		///                           out of range
+		std::uint64_t get_uint64()const;
+
+		/// \brief The value of a number
+		///
+		/// \throw std::runtime_error if the value is no number
+		double get_double()const;
+
+		/// \brief The unescaped value of a string
+		///
+		/// \throw std::runtime_error if the value is no string
+		std::string get_string()const;
+
+		/// \brief Compare a string value without unescaping it if possible
+		///
+		/// false if the value is missing or no string.
+		bool equals(boost::string_view text)const;
+
+
+	private:
+		lazy_json_value(lazy_json const* document, std::uint32_t index)
+			noexcept
+			: document_(document)
+			, index_(index) {}
+
+		/// \brief Index entry of the value
+		detail::lazy_json_token const& token()const;
+
+		/// \brief Throw if the value is not of type
+		void expect(lazy_json_type type)const;
+
+
+		/// \brief The document
+		lazy_json const* document_{nullptr};
+
+		/// \brief Index of the token in the document
+		std::uint32_t index_{0};
+
+
+		friend class lazy_json;
+	};
+
+
+	/// \brief JSON message that is indexed on receive and decoded on access
+	///
+	/// The constructor validates the message and records the position of
+	/// every value in a flat index. Nothing is decoded until it is accessed,
+	/// so reading a few fields of a big message is much cheaper than
+	/// building a full nlohmann::json. A message that was received in one
+	/// segment is used in place, otherwise it is copied once.
+	///
+	/// Numbers are not validated for range and strings are not validated
+	/// for UTF-8 until they are accessed.
+	class lazy_json{
+	public:
+		/// \brief Index buffer
+		///
+		/// \throw std::runtime_error if buffer is no valid JSON
+		explicit lazy_json(boost::beast::multi_buffer&& buffer);
+
+		/// \brief Index text
+		///
+		/// \throw std::runtime_error if text is no valid JSON
+		explicit lazy_json(std::string text);
+
+		lazy_json(lazy_json&& other);
+
+		lazy_json& operator=(lazy_json&& other);
+
+
+		/// \brief The top level value
+		lazy_json_value root()const noexcept{
+			return lazy_json_value(this, 0);
+		}
+
+		/// \brief Member key of the top level object
+		lazy_json_value find(boost::string_view key)const noexcept{
+			return root().find(key);
+		}
+
+		/// \brief Member key of the top level object
+		///
+		/// \throw std::out_of_range if not found or no object
+		lazy_json_value at(boost::string_view key)const{
+			return root().at(key);
+		}
+
+		/// \brief The JSON text
+		boost::string_view text()const noexcept{
+			return boost::string_view(data_, size_);
+		}
+
+
+	private:
+		/// \brief Build the index
+		void index();
+
+
+		/// \brief The received message
+		boost::beast::multi_buffer buffer_;
+
+		/// \brief The message if it was not received contiguous
+		std::string copy_;
+
+		/// \brief The JSON text
+		char const* data_;
+
+		/// \brief Count of bytes in the JSON text
+		std::size_t size_;
+
+		/// \brief The value index
+		std::vector< detail::lazy_json_token > tokens_;
+
+
+		friend class lazy_json_value;
+	};
+
+
+	template < typename Fn >
+	void lazy_json_value::for_each_member(Fn&& fn)const{
+		expect(lazy_json_type::object);
+		auto const& tokens = document_->tokens_;
+		auto index = index_ + 1;
+		for(std::size_t i = 0; i < tokens[index_].count; ++i){
+			lazy_json_value const key(document_, index);
+			lazy_json_value const value(document_, index + 1);
+			fn(key.get_string(), value);
+			index = tokens[index + 1].next;
+		}
+	}
+
+	template < typename Fn >
+	void lazy_json_value::for_each_element(Fn&& fn)const{
+		expect(lazy_json_type::array);
+		auto const& tokens = document_->tokens_;
+		auto index = index_ + 1;
+		for(std::size_t i = 0; i < tokens[index_].count; ++i){
+			fn(lazy_json_value(document_, index));
+			index = tokens[index].next;
+		}
+	}
+
+
+	template <>
+	struct from_multi_buffer_t< lazy_json >{
+		lazy_json operator()(boost::beast::multi_buffer&& buffer)const{
+			return lazy_json(std::move(buffer));
+		}
+	};
+
+
+}
+
+
+#endif
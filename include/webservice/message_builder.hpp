@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__message_builder__hpp_INCLUDED_
+#define _webservice__message_builder__hpp_INCLUDED_
+
+#include "shared_const_buffer.hpp"
+#include "conversion.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+
+namespace webservice{
+
+
+	namespace detail{
+
+
+		/// \brief Buffer storage from the recycling allocator
+		///
+		/// The data bytes follow the object in the same allocation. When the
+		/// last shared_const_buffer referencing it is destroyed, the storage
+		/// goes back to the pool of the thread that acquired it.
+		class pooled_buffer_holder final: public shared_buffer_holder{
+		public:
+			/// \brief Get storage for at least size bytes
+			static pooled_buffer_holder* acquire(std::size_t size);
+
+			/// \brief Return storage that was never frozen
+			void discard()noexcept{
+				destroy();
+			}
+
+
+			/// \brief First data byte
+			unsigned char* data()noexcept;
+
+			/// \brief Count of usable data bytes
+			std::size_t capacity()const noexcept{
+				return capacity_;
+			}
+
+
+		private:
+			explicit pooled_buffer_holder(std::size_t capacity)
+				: capacity_(capacity) {}
+
+			~pooled_buffer_holder() = default;
+
+			void destroy()noexcept override;
+
+
+			/// \brief Count of usable data bytes
+			std::size_t const capacity_;
+		};
+
+
+		/// \brief Distance from a pooled_buffer_holder to its data bytes
+		constexpr std::size_t pooled_buffer_header_size =
+			(sizeof(pooled_buffer_holder) + alignof(std::max_align_t) - 1) /
+			alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		inline unsigned char* pooled_buffer_holder::data()noexcept{
+			return reinterpret_cast< unsigned char* >(this) +
+				pooled_buffer_header_size;
+		}
+
+
+	}
+
+
+	/// \brief Serialize a message directly into sendable pooled storage
+	///
+	/// Storage is taken from the thread local pool of recycling_allocator.
+	/// freeze() turns the content into a shared_const_buffer without
+	/// copying; the storage is returned to the pool of the building thread
+	/// when the last reference is destroyed, on whatever thread that is. Messages of up to shared_const_buffer::copy_capacity
+	/// bytes are copied into a smaller block and the storage is reused at
+	/// once.
+	///
+	/// Thread safe: No.
+	class message_builder{
+	public:
+		/// \brief Empty builder, no storage taken yet
+		message_builder() = default;
+
+		/// \brief Empty builder with storage for at least capacity bytes
+		explicit message_builder(std::size_t capacity){
+			reserve(capacity);
+		}
+
+		message_builder(message_builder const&) = delete;
+
+		message_builder(message_builder&& other)noexcept
+			: storage_(other.storage_)
+			, size_(other.size_)
+		{
+			other.storage_ = nullptr;
+			other.size_ = 0;
+		}
+
+
+		/// \brief Return the storage to the pool
+		~message_builder(){
+			if(storage_){
+				storage_->discard();
+			}
+		}
+
+
+		message_builder& operator=(message_builder const&) = delete;
+
+		message_builder& operator=(message_builder&& other)noexcept{
+			if(this != &other){
+				if(storage_){
+					storage_->discard();
+				}
+				storage_ = other.storage_;
+				size_ = other.size_;
+				other.storage_ = nullptr;
+				other.size_ = 0;
+			}
+			return *this;
+		}
+
+
+		/// \brief Make sure that capacity() is at least capacity
+		void reserve(std::size_t capacity){
+			if(capacity > this->capacity()){
+				grow(capacity);
+			}
+		}
+
+		/// \brief Append size bytes from data
+		void append(void const* data, std::size_t size){
+			if(size == 0){
+				return;
+			}
+			reserve_append(size);
+			std::memcpy(storage_->data() + size_, data, size);
+			size_ += size;
+		}
+
+		/// \brief Append the characters of text
+		void append(boost::string_view text){
+			append(text.data(), text.size());
+		}
+
+		/// \brief Append a single character
+		void push_back(char c){
+			reserve_append(1);
+			storage_->data()[size_] = static_cast< unsigned char >(c);
+			++size_;
+		}
+
+		/// \brief Append size uninitialized bytes and return them
+		///
+		/// The pointer is valid until the next modification of the builder.
+		unsigned char* grow_by(std::size_t size){
+			reserve_append(size);
+			auto const result = storage_ ? storage_->data() + size_ : nullptr;
+			size_ += size;
+			return result;
+		}
+
+		/// \brief Remove the content, keep the storage
+		void clear()noexcept{
+			size_ = 0;
+		}
+
+
+		/// \brief The content
+		unsigned char const* data()const noexcept{
+			return storage_ ? storage_->data() : nullptr;
+		}
+
+		/// \brief Count of bytes in the content
+		std::size_t size()const noexcept{
+			return size_;
+		}
+
+		/// \brief Count of bytes that fit into the current storage
+		std::size_t capacity()const noexcept{
+			return storage_ ? storage_->capacity() : 0;
+		}
+
+
+		/// \brief Move the content into a shared_const_buffer
+		///
+		/// The builder is empty afterwards. It keeps its storage only if the
+		/// content was copied into the buffer because it was small enough.
+		shared_const_buffer freeze();
+
+
+	private:
+		/// \brief Make room for size more bytes with amortized growth
+		void reserve_append(std::size_t size){
+			if(size > capacity() - size_){
+				grow(size_ + size > 2 * size_ ? size_ + size : 2 * size_);
+			}
+		}
+
+		/// \brief Move content to new storage with at least capacity bytes
+		void grow(std::size_t capacity);
+
+
+		/// \brief Storage from the pool
+		detail::pooled_buffer_holder* storage_{nullptr};
+
+		/// \brief Count of bytes in the content
+		std::size_t size_{0};
+	};
+
+
+	template <>
+	struct to_shared_const_buffer_t< message_builder >{
+		shared_const_buffer operator()(message_builder data)const{
+			return data.freeze();
+		}
+	};
+
+
+}
+
+
+#endif
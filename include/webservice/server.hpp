@@ -12,6 +12,7 @@
 #include "http_request_handler.hpp"
 #include "ws_handler_interface.hpp"
 #include "error_handler.hpp"
+#include "executor.hpp"
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/address.hpp>
@@ -31,13 +32,37 @@ namespace webservice{
 		/// \param address IP address (IPv4 or IPv6)
 		/// \param port TCP Port
 		/// \param thread_count Count of threads that proccess request parallel
+		/// \param options Placement, CPU affinity and names of the threads
 		server(
 			std::unique_ptr< http_request_handler > http_handler,
 			std::unique_ptr< ws_handler_interface > service,
 			std::unique_ptr< error_handler > error_handler,
 			boost::asio::ip::address address,
 			std::uint16_t port,
-			std::uint8_t thread_count = 1
+			std::size_t thread_count = 1,
+			thread_options options = thread_options()
+		);
+
+		/// \brief Constructor for a server without own threads
+		///
+		/// The server runs all of its sessions on ioc and starts no thread.
+		/// The owner of ioc runs it, so one thread pool can be shared by
+		/// several servers and clients. ioc must be run until block()
+		/// returned, which is also called by the destructor.
+		///
+		/// \param http_handler Handles HTTP sessions
+		/// \param service Handles ws sessions
+		/// \param error_handler Handles error in the server
+		/// \param ioc The io_context that runs the server
+		/// \param address IP address (IPv4 or IPv6)
+		/// \param port TCP Port
+		server(
+			std::unique_ptr< http_request_handler > http_handler,
+			std::unique_ptr< ws_handler_interface > service,
+			std::unique_ptr< error_handler > error_handler,
+			boost::asio::io_context& ioc,
+			boost::asio::ip::address address,
+			std::uint16_t port
 		);
 
 		server(server const&) = delete;
@@ -73,13 +98,28 @@ namespace webservice{
 		bool is_stopped()noexcept;
 
 
-		/// \brief Get reference to the internal io_context
+		/// \brief Change the count of processing threads
+		///
+		/// \see executor::resize()
+		void resize(std::size_t thread_count);
+
+		/// \brief Scheduling delay histogram and per thread statistics
+		executor_stats stats();
+
+
+		/// \brief Get reference to the io_context
 		boost::asio::io_context& get_io_context()noexcept;
 
+		/// \brief Limits for new WebSocket sessions
+		class admission_control& admission()noexcept;
+
 
 	private:
+		/// \brief The own io_context, nullptr if it was supplied
+		std::unique_ptr< boost::asio::io_context > own_ioc_;
+
 		/// \brief The io_context is required for all I/O
-		boost::asio::io_context ioc_;
+		boost::asio::io_context& ioc_;
 
 		/// \brief Pointer to implementation
 		std::unique_ptr< class server_impl > impl_;
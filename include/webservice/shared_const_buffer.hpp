@@ -9,13 +9,21 @@
 #ifndef _webservice__shared_const_buffer__hpp_INCLUDED_
 #define _webservice__shared_const_buffer__hpp_INCLUDED_
 
-#include <boost/asio/buffer.hpp>
+#include "handler_allocator.hpp"
 
-#include <boost/any.hpp>
+#include <boost/asio/buffer.hpp>
 
 #include <boost/optional.hpp>
 
+#include <initializer_list>
+#include <type_traits>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <cstring>
 #include <memory>
+#include <atomic>
+#include <new>
 
 
 namespace webservice{
@@ -25,44 +33,259 @@ namespace webservice{
 
 	constexpr construct_via_data_and_size_t construct_via_data_and_size{};
 
+
+	class shared_const_buffer;
+
+
+	namespace detail{
+
+
+		/// \brief Intrusively reference counted owner of buffer data
+		class shared_buffer_holder{
+		public:
+			shared_buffer_holder() = default;
+
+			shared_buffer_holder(shared_buffer_holder const&) = delete;
+
+			shared_buffer_holder& operator=(shared_buffer_holder const&)
+				= delete;
+
+
+			/// \brief Add a reference
+			void add_ref()noexcept{
+				refs_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			/// \brief Remove a reference, destroy if it was the last one
+			void release()noexcept{
+				if(refs_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+					destroy();
+				}
+			}
+
+
+		protected:
+			virtual ~shared_buffer_holder() = default;
+
+			/// \brief Called when the last reference is released
+			///
+			/// Default implementation deletes this.
+			virtual void destroy()noexcept{
+				delete this;
+			}
+
+
+		private:
+			/// \brief Count of shared_const_buffer objects referencing this
+			std::atomic< std::size_t > refs_{1};
+		};
+
+
+		/// \brief Holds an object of type T which owns the buffer data
+		template < typename T >
+		class shared_buffer_value_holder final: public shared_buffer_holder{
+		public:
+			template < typename U >
+			explicit shared_buffer_value_holder(U&& value)
+				: value(static_cast< U&& >(value)) {}
+
+			/// \brief The owning object
+			T const value;
+		};
+
+
+		/// \brief Holds a copy of small buffer data in recycled memory
+		///
+		/// The data follows the holder in the same block.
+		class shared_buffer_copy_holder final: public shared_buffer_holder{
+		public:
+			/// \brief Copy data into a new holder with reference count 1
+			static shared_buffer_copy_holder* make(
+				boost::asio::const_buffer const& data
+			){
+				auto const size = sizeof(shared_buffer_copy_holder)
+					+ data.size();
+				auto const holder = new(handler_allocate(size))
+					shared_buffer_copy_holder(size);
+				std::memcpy(holder->data(), data.data(), data.size());
+				return holder;
+			}
+
+			/// \brief The copied data
+			void* data()noexcept{
+				return this + 1;
+			}
+
+
+		protected:
+			/// \brief Return the block to the recycling allocator
+			void destroy()noexcept override{
+				auto const size = size_;
+				this->~shared_buffer_copy_holder();
+				handler_deallocate(this, size);
+			}
+
+
+		private:
+			explicit shared_buffer_copy_holder(std::size_t size)noexcept
+				: size_(size) {}
+
+			/// \brief Size of the block including the data
+			std::size_t const size_;
+		};
+
+
+		template < typename T >
+		using enable_if_not_shared_const_buffer = std::enable_if_t<
+			!std::is_same< std::decay_t< T >, shared_const_buffer >::value >;
+
+
+	}
+
+
 	/// \brief A generic reference-counted non-modifiable buffer class
+	///
+	/// Data up to copy_capacity bytes is copied into a block of the
+	/// recycling allocator. Larger data is moved or copied into a single
+	/// allocation. Both have an intrusive atomic reference count, copies
+	/// share it. The data never lives in the object itself, so buffers
+	/// taken from it stay valid while the object is moved.
+	///
+	/// A shared_const_buffer can also be a sequence of other
+	/// shared_const_buffer objects, for example a shared header and a
+	/// message specific body. The segments keep their own reference counts
+	/// and are written with a single gathered write.
 	class shared_const_buffer{
 	public:
-		/// \brief Move or copy the data to a shared_ptr
-		template < typename T >
-		explicit shared_const_buffer(T&& data)
-			: shared_const_buffer(
-				std::make_shared< typename std::decay< T >::type const >(
-					static_cast< T&& >(data))) {}
+		/// \brief Max size of data that is copied into recycled memory
+		static constexpr std::size_t copy_capacity = 32;
+
+
+		/// \brief Move or copy the data into the buffer
+		template < typename T,
+			typename = detail::enable_if_not_shared_const_buffer< T > >
+		explicit shared_const_buffer(T&& data){
+			boost::asio::const_buffer const buffer(boost::asio::buffer(data));
+			if(buffer.size() <= copy_capacity){
+				store_copy(buffer);
+				return;
+			}
+
+			auto holder = make_holder< std::decay_t< T > >(
+				static_cast< T&& >(data));
+			buffer_ = boost::asio::buffer(holder->value);
+			holder_ = holder;
+		}
 
 		/// \brief Use the shared_ptr directly
 		template < typename T >
-		explicit shared_const_buffer(std::shared_ptr< T > data)
-			: data_(std::move(data))
-			, buffer_(boost::asio::buffer(
-				*boost::any_cast< std::shared_ptr< T > >(data_))) {}
+		explicit shared_const_buffer(std::shared_ptr< T > data){
+			auto holder = make_holder< std::shared_ptr< T > >(std::move(data));
+			buffer_ = boost::asio::buffer(*holder->value);
+			holder_ = holder;
+		}
 
-		/// \brief Move or copy the data to a shared_ptr
-		template < typename T >
-		explicit shared_const_buffer(T&& data, construct_via_data_and_size_t c)
-			: shared_const_buffer(
-				std::make_shared< typename std::decay< T >::type const >(
-					static_cast< T&& >(data)), c) {}
+		/// \brief Move or copy the data into the buffer
+		template < typename T,
+			typename = detail::enable_if_not_shared_const_buffer< T > >
+		explicit shared_const_buffer(
+			T&& data,
+			construct_via_data_and_size_t
+		){
+			auto const buffer = data_and_size(data);
+			if(buffer.size() <= copy_capacity){
+				store_copy(buffer);
+				return;
+			}
+
+			auto holder = make_holder< std::decay_t< T > >(
+				static_cast< T&& >(data));
+			buffer_ = data_and_size(holder->value);
+			holder_ = holder;
+		}
 
 		/// \brief Use the shared_ptr directly
 		template < typename T >
 		explicit shared_const_buffer(
 			std::shared_ptr< T > data,
 			construct_via_data_and_size_t
+		){
+			auto holder = make_holder< std::shared_ptr< T > >(std::move(data));
+			buffer_ = data_and_size(*holder->value);
+			holder_ = holder;
+		}
+
+
+		/// \brief Gather segments without copying their data
+		explicit shared_const_buffer(
+			std::initializer_list< shared_const_buffer > segments
 		)
-			: data_(std::move(data))
-			, buffer_(boost::asio::buffer(
-					static_cast< void const* >(
-						boost::any_cast< std::shared_ptr< T > >(data_)->data()
-					),
-					boost::any_cast< std::shared_ptr< T > >(data_)->size() *
-					sizeof(*data->data())
-				)) {}
+			: shared_const_buffer(
+				std::vector< shared_const_buffer >(segments)) {}
+
+		/// \brief Gather segments without copying their data
+		explicit shared_const_buffer(
+			std::vector< shared_const_buffer > segments);
+
+
+		/// \brief Share the data of other
+		shared_const_buffer(shared_const_buffer const& other)noexcept
+			: holder_(other.holder_)
+			, buffer_(other.buffer_)
+			, sequence_(other.sequence_)
+		{
+			if(holder_){
+				holder_->add_ref();
+			}
+		}
+
+		/// \brief Take the data of other
+		shared_const_buffer(shared_const_buffer&& other)noexcept
+			: holder_(other.holder_)
+			, buffer_(other.buffer_)
+			, sequence_(other.sequence_)
+		{
+			other.holder_ = nullptr;
+			other.buffer_ = boost::asio::const_buffer();
+			other.sequence_ = false;
+		}
+
+
+		/// \brief Release the data
+		~shared_const_buffer(){
+			if(holder_){
+				holder_->release();
+			}
+		}
+
+
+		/// \brief Share the data of other
+		shared_const_buffer& operator=(shared_const_buffer const& other)
+			noexcept
+		{
+			shared_const_buffer tmp(other);
+			return *this = std::move(tmp);
+		}
+
+		/// \brief Take the data of other
+		shared_const_buffer& operator=(shared_const_buffer&& other)noexcept{
+			if(this == &other){
+				return *this;
+			}
+
+			if(holder_){
+				holder_->release();
+			}
+
+			holder_ = other.holder_;
+			buffer_ = other.buffer_;
+			sequence_ = other.sequence_;
+			other.holder_ = nullptr;
+			other.buffer_ = boost::asio::const_buffer();
+			other.sequence_ = false;
+
+			return *this;
+		}
 
 
 		/// \brief Buffer interface value_type
@@ -74,24 +297,181 @@ namespace webservice{
 
 		/// \brief Buffer interface begin
 		boost::asio::const_buffer const* begin()const{
-			return &buffer_;
+			return sequence_
+				? static_cast< boost::asio::const_buffer const* >(
+					buffer_.data())
+				: &buffer_;
 		}
 
 		/// \brief Buffer interface end
 		boost::asio::const_buffer const* end()const{
-			return &buffer_ + 1;
+			return sequence_
+				? static_cast< boost::asio::const_buffer const* >(
+					buffer_.data()) + sequence_size()
+				: &buffer_ + 1;
+		}
+
+
+		/// \brief Count of segments
+		std::size_t segment_count()const noexcept{
+			return sequence_ ? sequence_size() : 1;
+		}
+
+		/// \brief Sum of the sizes of all segments
+		std::size_t size()const noexcept{
+			return boost::asio::buffer_size(*this);
+		}
+
+
+		/// \brief Part of a single segment buffer, sharing its data
+		///
+		/// \throw std::logic_error if this is a multi segment buffer
+		/// \throw std::out_of_range if the part is not inside the buffer
+		shared_const_buffer slice(std::size_t offset, std::size_t size)const{
+			if(sequence_){
+				throw std::logic_error(
+					"slice of multi segment shared_const_buffer");
+			}
+			if(offset > buffer_.size() || size > buffer_.size() - offset){
+				throw std::out_of_range("shared_const_buffer slice ["
+					+ std::to_string(offset) + ", "
+					+ std::to_string(offset + size) + ") out of range");
+			}
+
+			boost::asio::const_buffer const part(
+				static_cast< unsigned char const* >(buffer_.data()) + offset,
+				size);
+			if(!holder_ || size <= copy_capacity){
+				return shared_const_buffer(part);
+			}
+
+			holder_->add_ref();
+			return shared_const_buffer(holder_, part);
 		}
 
 
 	private:
-		/// \brief A shared_ptr that keeps the buffer data alive
-		boost::any data_;
+		/// \brief Adopt a reference to holder which keeps buffer alive
+		shared_const_buffer(
+			detail::shared_buffer_holder* holder,
+			boost::asio::const_buffer buffer
+		)noexcept
+			: holder_(holder)
+			, buffer_(buffer) {}
+
+		/// \brief Create a holder for value with reference count 1
+		template < typename T, typename U >
+		static detail::shared_buffer_value_holder< T >* make_holder(U&& value){
+			return new detail::shared_buffer_value_holder< T >(
+				static_cast< U&& >(value));
+		}
+
+		/// \brief Buffer from data() and size() of data
+		template < typename T >
+		static boost::asio::const_buffer data_and_size(T const& data){
+			return boost::asio::const_buffer(
+				static_cast< void const* >(data.data()),
+				data.size() * sizeof(*data.data()));
+		}
+
+		/// \brief Count of segments of a multi segment buffer
+		std::size_t sequence_size()const noexcept{
+			return buffer_.size() / sizeof(boost::asio::const_buffer);
+		}
+
+		/// \brief Copy the data of buffer to a shared_buffer_copy_holder
+		///
+		/// Empty data needs no holder.
+		void store_copy(boost::asio::const_buffer const& buffer){
+			if(buffer.size() == 0){
+				return;
+			}
+
+			auto const holder = detail::shared_buffer_copy_holder::make(
+				buffer);
+			buffer_ = boost::asio::const_buffer(holder->data(), buffer.size());
+			holder_ = holder;
+		}
+
+
+		/// \brief Keeps the buffer data alive, nullptr if data is empty
+		detail::shared_buffer_holder* holder_{nullptr};
 
 		/// \brief Buffer representation of the data
+		///
+		/// For a multi segment buffer this references the array of segment
+		/// buffers in the sequence holder instead.
 		boost::asio::const_buffer buffer_;
+
+		/// \brief Set if this is a multi segment buffer
+		bool sequence_{false};
+
+
+		friend class message_builder;
 	};
 
 
+	namespace detail{
+
+
+		/// \brief Holds the segments of a multi segment shared_const_buffer
+		class shared_buffer_sequence_holder final: public shared_buffer_holder{
+		public:
+			explicit shared_buffer_sequence_holder(
+				std::vector< shared_const_buffer >&& segments
+			)
+				: segments_(std::move(segments))
+			{
+				std::size_t count = 0;
+				for(auto const& segment: segments_){
+					count += segment.segment_count();
+				}
+
+				buffers_.reserve(count);
+				for(auto const& segment: segments_){
+					buffers_.insert(
+						buffers_.end(), segment.begin(), segment.end());
+				}
+			}
+
+			/// \brief Buffers of all segments in order
+			std::vector< boost::asio::const_buffer > const& buffers()
+				const noexcept
+			{
+				return buffers_;
+			}
+
+
+		private:
+			/// \brief Keeps the segment data alive
+			std::vector< shared_const_buffer > const segments_;
+
+			/// \brief Buffers of all segments in order
+			std::vector< boost::asio::const_buffer > buffers_;
+		};
+
+
+	}
+
+
+	inline shared_const_buffer::shared_const_buffer(
+		std::vector< shared_const_buffer > segments
+	){
+		if(segments.size() == 1){
+			*this = std::move(segments.front());
+			return;
+		}
+
+		auto holder = new detail::shared_buffer_sequence_holder(
+			std::move(segments));
+		auto const& buffers = holder->buffers();
+		buffer_ = boost::asio::const_buffer(buffers.data(),
+			buffers.size() * sizeof(boost::asio::const_buffer));
+		sequence_ = true;
+		holder_ = holder;
+	}
+
+
 }
 
 
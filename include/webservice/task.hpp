@@ -0,0 +1,334 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__task__hpp_INCLUDED_
+#define _webservice__task__hpp_INCLUDED_
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "webservice/task.hpp requires C++20 coroutines"
+#endif
+
+#include "handler_allocator.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+
+namespace webservice{
+
+
+	namespace detail{
+
+
+		/// \brief Frame allocation of all coroutine types
+		///
+		/// Frames come from the recycling allocator, so a coroutine call per
+		/// message does not call operator new in steady state.
+		struct frame_allocation{
+			static void* operator new(std::size_t size){
+				return handler_allocate(size);
+			}
+
+			static void operator delete(void* frame, std::size_t size)
+			noexcept{
+				handler_deallocate(frame, size);
+			}
+		};
+
+
+	}
+
+
+	template < typename T = void >
+	class task;
+
+
+	namespace detail{
+
+
+		/// \brief Continue the awaiting coroutine when a task returned
+		struct task_final_awaiter{
+			bool await_ready()const noexcept{
+				return false;
+			}
+
+			template < typename Promise >
+			std::coroutine_handle<> await_suspend(
+				std::coroutine_handle< Promise > handle
+			)const noexcept{
+				return handle.promise().continuation;
+			}
+
+			void await_resume()const noexcept{}
+		};
+
+
+		/// \brief Common part of all task promises
+		struct task_promise_base: frame_allocation{
+			std::suspend_always initial_suspend()const noexcept{
+				return {};
+			}
+
+			task_final_awaiter final_suspend()const noexcept{
+				return {};
+			}
+
+			void unhandled_exception()noexcept{
+				error = std::current_exception();
+			}
+
+			void rethrow_error()const{
+				if(error){
+					std::rethrow_exception(error);
+				}
+			}
+
+
+			/// \brief The awaiting coroutine
+			std::coroutine_handle<> continuation;
+
+			/// \brief Exception that left the task
+			std::exception_ptr error;
+		};
+
+
+		/// \brief Promise of a task that returns T
+		template < typename T >
+		struct task_promise: task_promise_base{
+			task< T > get_return_object()noexcept;
+
+			template < typename U >
+			void return_value(U&& result){
+				value.emplace(static_cast< U&& >(result));
+			}
+
+			T result(){
+				rethrow_error();
+				return std::move(*value);
+			}
+
+
+			/// \brief The result
+			std::optional< T > value;
+		};
+
+		/// \brief Promise of a task that returns nothing
+		template <>
+		struct task_promise< void >: task_promise_base{
+			task< void > get_return_object()noexcept;
+
+			void return_void()const noexcept{}
+
+			void result()const{
+				rethrow_error();
+			}
+		};
+
+
+	}
+
+
+	/// \brief Coroutine that starts when it is awaited
+	///
+	/// Use it to split the coroutine of a session or request into functions.
+	/// The frame comes from the recycling allocator, so calling a task per
+	/// message doesn't call operator new in steady state.
+	template < typename T >
+	class [[nodiscard]] task{
+	public:
+		using promise_type = detail::task_promise< T >;
+
+
+		task(task&& other)noexcept
+			: handle_(std::exchange(other.handle_, nullptr)) {}
+
+		~task(){
+			if(handle_){
+				handle_.destroy();
+			}
+		}
+
+		task& operator=(task&& other)noexcept{
+			if(this != &other){
+				if(handle_){
+					handle_.destroy();
+				}
+				handle_ = std::exchange(other.handle_, nullptr);
+			}
+			return *this;
+		}
+
+
+		bool await_ready()const noexcept{
+			return false;
+		}
+
+		/// \brief Run the task, it continues the awaiting coroutine when it
+		///        returned
+		std::coroutine_handle<> await_suspend(
+			std::coroutine_handle<> continuation
+		)noexcept{
+			handle_.promise().continuation = continuation;
+			return handle_;
+		}
+
+		/// \brief The result or the exception of the task
+		T await_resume(){
+			return handle_.promise().result();
+		}
+
+
+	private:
+		explicit task(std::coroutine_handle< promise_type > handle)noexcept
+			: handle_(handle) {}
+
+
+		/// \brief The coroutine
+		std::coroutine_handle< promise_type > handle_;
+
+
+		friend promise_type;
+	};
+
+
+	namespace detail{
+
+
+		template < typename T >
+		task< T > task_promise< T >::get_return_object()noexcept{
+			return task< T >(
+				std::coroutine_handle< task_promise >::from_promise(*this));
+		}
+
+		inline task< void > task_promise< void >::get_return_object()noexcept{
+			return task< void >(
+				std::coroutine_handle< task_promise >::from_promise(*this));
+		}
+
+
+	}
+
+
+	/// \brief Coroutine that owns itself after start()
+	///
+	/// The root of the coroutine of a WebSocket session or an HTTP request.
+	/// Exceptions that leave it are reported to the function given to
+	/// start().
+	class [[nodiscard]] detached_task{
+	public:
+		struct promise_type: detail::frame_allocation{
+			detached_task get_return_object()noexcept{
+				return detached_task(std::coroutine_handle< promise_type >
+					::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend()const noexcept{
+				return {};
+			}
+
+			std::suspend_never final_suspend()const noexcept{
+				return {};
+			}
+
+			void return_void()const noexcept{}
+
+			void unhandled_exception()noexcept{
+				if(on_exception){
+					on_exception(std::current_exception());
+				}
+			}
+
+
+			/// \brief Destroyed with the coroutine
+			std::shared_ptr< void > owner;
+
+			/// \brief Called with exceptions that leave the coroutine
+			std::function< void(std::exception_ptr) > on_exception;
+		};
+
+
+		detached_task(detached_task&& other)noexcept
+			: handle_(std::exchange(other.handle_, nullptr)) {}
+
+		/// \brief Destroy the coroutine if it was not started
+		~detached_task(){
+			if(handle_){
+				handle_.destroy();
+			}
+		}
+
+		detached_task& operator=(detached_task const&) = delete;
+
+
+		/// \brief Run the coroutine until it suspends the first time
+		///
+		/// owner is destroyed after the coroutine returned. on_exception
+		/// must not throw.
+		void start(
+			std::shared_ptr< void > owner,
+			std::function< void(std::exception_ptr) > on_exception
+		){
+			auto& promise = handle_.promise();
+			promise.owner = std::move(owner);
+			promise.on_exception = std::move(on_exception);
+
+			std::exchange(handle_, nullptr).resume();
+		}
+
+
+	private:
+		explicit detached_task(std::coroutine_handle< promise_type > handle)
+			noexcept
+			: handle_(handle) {}
+
+
+		/// \brief The coroutine, nullptr after start()
+		std::coroutine_handle< promise_type > handle_;
+	};
+
+
+	/// \brief Continue the coroutine on a thread of ioc
+	///
+	/// Use it with executor::blocking_io_context() to run blocking calls of
+	/// a coroutine without delaying the session threads.
+	class resume_on{
+	public:
+		explicit resume_on(boost::asio::io_context& ioc)noexcept
+			: ioc_(ioc) {}
+
+
+		bool await_ready()const noexcept{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle){
+			boost::asio::post(ioc_, bind_recycling_allocator(
+				[handle]{ handle.resume(); }));
+		}
+
+		void await_resume()const noexcept{}
+
+
+	private:
+		/// \brief The target io_context
+		boost::asio::io_context& ioc_;
+	};
+
+
+}
+
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "ws_identifier.hpp"
 #include "async_locker.hpp"
+#include "admission_control.hpp"
 
 #include <boost/asio/ip/tcp.hpp>
 
@@ -47,10 +48,13 @@ namespace webservice{
 
 		/// \brief Create a new server websocket session
 		///
-		/// Called by the server.
+		/// Called by the server. ticket is available to on_server_connect()
+		/// by take_admission_ticket(), it is released when this function
+		/// returns if on_server_connect() didn't take it.
 		void server_connect(
 			boost::asio::ip::tcp::socket&& socket,
-			http_request&& req);
+			http_request&& req,
+			admission_control::ticket&& ticket = admission_control::ticket());
 
 		/// \brief Create a new client websocket session
 		///
@@ -102,6 +106,13 @@ namespace webservice{
 		/// \throw std::logic_error if it is called more than one time
 		void shutdown_finished();
 
+		/// \brief Take the admission ticket of the running server_connect()
+		///
+		/// Call it in on_server_connect() before the socket leaves the call
+		/// and keep it until the session exists. Returns an empty ticket if
+		/// there is none.
+		static admission_control::ticket take_admission_ticket()noexcept;
+
 
 	private:
 		/// \brief Called by set_executor
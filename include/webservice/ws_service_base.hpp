@@ -10,13 +10,23 @@
 #define _webservice__ws_service_base__hpp_INCLUDED_
 
 #include "shared_const_buffer.hpp"
+#include "handler_allocator.hpp"
 #include "ws_service_interface.hpp"
 #include "ws_session_settings.hpp"
 #include "ws_session.hpp"
+#include "ws_session_key.hpp"
+#include "ws_tag_index.hpp"
 #include "executor.hpp"
 #include "server.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <set>
 
 #include <boost/asio/connect.hpp>
@@ -51,9 +61,13 @@ namespace webservice{
 
 
 		/// \brief Send a text message to session
+		///
+		/// handler is called when the message was written or dropped, e.g.
+		/// because the session doesn't exist anymore.
 		void send_text(
 			ws_identifier identifier,
-			shared_const_buffer buffer
+			shared_const_buffer buffer,
+			ws_write_handler handler = ws_write_handler()
 		){
 			if(!impl_){
 				throw std::logic_error(
@@ -65,12 +79,14 @@ namespace webservice{
 					this,
 					lock = locker_.make_lock(),
 					identifier,
-					buffer = std::move(buffer)
+					buffer = std::move(buffer),
+					handler = std::move(handler)
 				]()mutable noexcept{
 					if(impl_->map_.count(identifier) > 0){
-						identifier.session->send(true, std::move(buffer));
+						identifier.session->send(true, std::move(buffer),
+							std::move(handler));
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 		/// \brief Send a text message to all session
@@ -101,24 +117,55 @@ namespace webservice{
 					fn = std::move(fn),
 					buffer = std::move(buffer)
 				]()mutable noexcept{
+					value_section section(*impl_);
 					for(auto& session: impl_->map_){
 						ws_identifier identifier(strip_const(session.first));
 						try{
-							if(fn(identifier, session.second)){
+							if(call_locked(session.second, fn, identifier)){
 								identifier.session->send(true, buffer);
 							}
 						}catch(...){
 							on_exception(identifier, std::current_exception());
 						}
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send a text message to all sessions whose tag word
+		///        matches filter
+		void send_text_if(
+			tag_filter filter,
+			shared_const_buffer buffer
+		){
+			if(!impl_){
+				throw std::logic_error(
+					"called send_text_if() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					filter,
+					buffer = std::move(buffer)
+				]()mutable noexcept{
+					impl_->tags_.for_each_match(filter,
+						[&buffer](ws_session& session)noexcept{
+							session.send(true, buffer);
+						});
+				}, recycling_allocator< void >());
 		}
 
 
 		/// \brief Send a binary message to session
+		///
+		/// handler is called when the message was written or dropped, e.g.
+		/// because the session doesn't exist anymore.
 		void send_binary(
 			ws_identifier identifier,
-			shared_const_buffer buffer
+			shared_const_buffer buffer,
+			ws_write_handler handler = ws_write_handler()
 		){
 			if(!impl_){
 				throw std::logic_error(
@@ -130,12 +177,14 @@ namespace webservice{
 					this,
 					lock = locker_.make_lock(),
 					identifier,
-					buffer = std::move(buffer)
+					buffer = std::move(buffer),
+					handler = std::move(handler)
 				]()mutable noexcept{
 					if(impl_->map_.count(identifier) > 0){
-						identifier.session->send(false, std::move(buffer));
+						identifier.session->send(false, std::move(buffer),
+							std::move(handler));
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 		/// \brief Send a binary message to all session
@@ -166,17 +215,182 @@ namespace webservice{
 					fn = std::move(fn),
 					buffer = std::move(buffer)
 				]()mutable noexcept{
+					value_section section(*impl_);
 					for(auto& session: impl_->map_){
 						ws_identifier identifier(strip_const(session.first));
 						try{
-							if(fn(identifier, session.second)){
+							if(call_locked(session.second, fn, identifier)){
 								identifier.session->send(false, buffer);
 							}
 						}catch(...){
 							on_exception(identifier, std::current_exception());
 						}
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send a binary message to all sessions whose tag word
+		///        matches filter
+		void send_binary_if(
+			tag_filter filter,
+			shared_const_buffer buffer
+		){
+			if(!impl_){
+				throw std::logic_error(
+					"called send_binary_if() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					filter,
+					buffer = std::move(buffer)
+				]()mutable noexcept{
+					impl_->tags_.for_each_match(filter,
+						[&buffer](ws_session& session)noexcept{
+							session.send(false, buffer);
+						});
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send many messages to many sessions
+		///
+		/// messages is a range of tuples (ws_identifier, shared_const_buffer,
+		/// bool is_text). The messages are collected in one batch and
+		/// dispatched in one step, every session is addressed once with all
+		/// of its messages. Messages to the same session keep their order.
+		///
+		/// The batch, its shared state, the strand call and the queue
+		/// entries use recycling_allocator. Only the message vector of a
+		/// batch that exceeds the largest pooled block calls operator new.
+		template < typename Range >
+		void send_many(Range const& messages){
+			if(!impl_){
+				throw std::logic_error(
+					"called send_many() before server was set");
+			}
+
+			auto batch = std::allocate_shared< ws_send_batch >(
+				recycling_allocator< ws_send_batch >());
+			using std::begin;
+			using std::end;
+			reserve_batch(*batch, begin(messages), end(messages),
+				typename std::iterator_traits< decltype(begin(messages)) >
+					::iterator_category());
+			for(auto const& message: messages){
+				batch->push_back(ws_batch_message{
+					ws_identifier(std::get< 0 >(message)).session,
+					static_cast< bool >(std::get< 2 >(message)),
+					std::get< 1 >(message)});
+			}
+
+			std::stable_sort(batch->begin(), batch->end(),
+				[](ws_batch_message const& l, ws_batch_message const& r){
+					return l.session < r.session;
+				});
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					batch = std::shared_ptr< ws_send_batch const >(
+						std::move(batch))
+				]()mutable noexcept{
+					auto const size = batch->size();
+					for(std::size_t first = 0, last = 0; first < size;
+						first = last
+					){
+						auto const session = (*batch)[first].session;
+						while(
+							last < size && (*batch)[last].session == session
+						){
+							++last;
+						}
+
+						if(impl_->map_.count(session) > 0){
+							session->send(batch, first, last);
+						}
+					}
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send a message encoded per session to all sessions
+		///
+		/// encode(identifier) is called on the service strand for every
+		/// session and returns a std::pair< shared_const_buffer, bool > with
+		/// the data and true for a text or false for a binary message. It may
+		/// cache its results, e.g. one per subprotocol().
+		template < typename Encode >
+		void send_encoded(Encode encode){
+			if(!impl_){
+				throw std::logic_error(
+					"called send_encoded() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					encode = std::move(encode)
+				]()mutable noexcept{
+					for(auto& session: impl_->map_){
+						ws_identifier identifier(strip_const(session.first));
+						try{
+							auto message = encode(identifier);
+							identifier.session->send(
+								message.second, std::move(message.first));
+						}catch(...){
+							on_exception(identifier, std::current_exception());
+						}
+					}
+				}, recycling_allocator< void >());
+		}
+
+		/// \brief Send a message encoded for session
+		///
+		/// encode(identifier) is called on the service strand if the session
+		/// exists. See send_encoded(Encode).
+		template < typename Encode >
+		void send_encoded(ws_identifier identifier, Encode encode){
+			if(!impl_){
+				throw std::logic_error(
+					"called send_encoded() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					identifier,
+					encode = std::move(encode)
+				]()mutable noexcept{
+					if(impl_->map_.count(identifier) == 0){
+						return;
+					}
+
+					try{
+						auto message = encode(identifier);
+						identifier.session->send(
+							message.second, std::move(message.first));
+					}catch(...){
+						on_exception(identifier, std::current_exception());
+					}
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Negotiated WebSocket subprotocol of session, empty if none
+		///
+		/// Must only be called while the session exists, e.g. from one of its
+		/// handlers or from the encode function of send_encoded().
+		static std::string const& subprotocol(ws_identifier identifier)
+			noexcept
+		{
+			return identifier.session->subprotocol();
 		}
 
 
@@ -200,7 +414,7 @@ namespace webservice{
 						identifier.session->close(reason);
 					}
 
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 		/// \brief Shutdown all sessions
@@ -231,21 +445,141 @@ namespace webservice{
 					fn = std::move(fn),
 					reason = std::move(reason)
 				]()mutable noexcept{
+					value_section section(*impl_);
 					for(auto& session: impl_->map_){
 						ws_identifier identifier(strip_const(session.first));
 						try{
-							if(fn(identifier, session.second)){
+							if(call_locked(session.second, fn, identifier)){
 								identifier.session->close(reason);
 							}
 						}catch(...){
 							on_exception(identifier, std::current_exception());
 						}
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send a close to all sessions whose tag word matches filter
+		void close_if(
+			tag_filter filter,
+			boost::beast::websocket::close_reason reason
+		){
+			if(!impl_){
+				throw std::logic_error(
+					"called close_if() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					filter,
+					reason = std::move(reason)
+				]()mutable noexcept{
+					impl_->tags_.for_each_match(filter,
+						[&reason](ws_session& session)noexcept{
+							session.close(reason);
+						});
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Send a text message to the session indexed by key
+		///
+		/// Requires a ws_session_key_t specialization for Value. Does nothing
+		/// if no session has the key.
+		template < typename Key >
+		void send_text_to_key(Key&& key, shared_const_buffer buffer){
+			static_assert(detail::has_session_key< Value >::value,
+				"send_text_to_key() requires a ws_session_key_t "
+				"specialization for Value");
+
+			if(!impl_){
+				throw std::logic_error(
+					"called send_text_to_key() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					key = key_type< Value >(static_cast< Key&& >(key)),
+					buffer = std::move(buffer)
+				]()mutable noexcept{
+					auto session = impl_->keys_.find(key);
+					if(session != nullptr){
+						session->send(true, std::move(buffer));
+					}
+				}, recycling_allocator< void >());
+		}
+
+		/// \brief Send a binary message to the session indexed by key
+		///
+		/// Requires a ws_session_key_t specialization for Value. Does nothing
+		/// if no session has the key.
+		template < typename Key >
+		void send_binary_to_key(Key&& key, shared_const_buffer buffer){
+			static_assert(detail::has_session_key< Value >::value,
+				"send_binary_to_key() requires a ws_session_key_t "
+				"specialization for Value");
+
+			if(!impl_){
+				throw std::logic_error(
+					"called send_binary_to_key() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					key = key_type< Value >(static_cast< Key&& >(key)),
+					buffer = std::move(buffer)
+				]()mutable noexcept{
+					auto session = impl_->keys_.find(key);
+					if(session != nullptr){
+						session->send(false, std::move(buffer));
+					}
+				}, recycling_allocator< void >());
+		}
+
+		/// \brief Shutdown the session indexed by key
+		///
+		/// Requires a ws_session_key_t specialization for Value. Does nothing
+		/// if no session has the key.
+		template < typename Key >
+		void close_key(
+			Key&& key,
+			boost::beast::websocket::close_reason reason
+		){
+			static_assert(detail::has_session_key< Value >::value,
+				"close_key() requires a ws_session_key_t "
+				"specialization for Value");
+
+			if(!impl_){
+				throw std::logic_error(
+					"called close_key() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					key = key_type< Value >(static_cast< Key&& >(key)),
+					reason = std::move(reason)
+				]()mutable noexcept{
+					auto session = impl_->keys_.find(key);
+					if(session != nullptr){
+						session->close(reason);
+					}
+				}, recycling_allocator< void >());
 		}
 
 
 		/// \brief Modify value of identifier via the given function async
+		///
+		/// If ws_session_key_t is specialized for Value, the session is
+		/// reindexed by its new key afterwards.
 		template < typename Fn >
 		void modify_value(ws_identifier identifier, Fn fn){
 			assert(impl_ != nullptr);
@@ -259,13 +593,18 @@ namespace webservice{
 				]()mutable noexcept{
 					auto iter = impl_->map_.find(identifier);
 					if(iter != impl_->map_.end()){
+						value_section section(*impl_);
+						auto value_lock = lock_value(iter->second);
+
 						try{
-							fn(iter->second);
+							fn(iter->second.value);
 						}catch(...){
 							on_exception(identifier, std::current_exception());
 						}
+
+						update_key(iter->first, iter->second);
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 		/// \brief Set value of identifier to given value async
@@ -278,6 +617,42 @@ namespace webservice{
 		}
 
 
+		/// \brief Set the bits in set and clear the bits in clear of the tag
+		///        word of identifier async
+		///
+		/// Bits in both masks are set. The tag word of a new session is 0.
+		void modify_tags(
+			ws_identifier identifier,
+			std::uint64_t set,
+			std::uint64_t clear
+		){
+			if(!impl_){
+				throw std::logic_error(
+					"called modify_tags() before server was set");
+			}
+
+			impl_->strand_.dispatch(
+				[
+					this,
+					lock = locker_.make_lock(),
+					identifier,
+					set,
+					clear
+				]()mutable noexcept{
+					auto iter = impl_->map_.find(identifier);
+					if(iter != impl_->map_.end()){
+						auto const slot = iter->second.tag_slot;
+						impl_->tags_.set(slot,
+							(impl_->tags_.get(slot) & ~clear) | set);
+					}
+				}, recycling_allocator< void >());
+		}
+
+		/// \brief Set the tag word of identifier async
+		void set_tags(ws_identifier identifier, std::uint64_t tags){
+			modify_tags(identifier, tags, ~std::uint64_t(0));
+		}
+
 	protected:
 		/// \brief Create the implementation
 		///
@@ -310,7 +685,7 @@ namespace webservice{
 					}
 
 					shutdown_ = true;
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 		/// \brief Erase the session from map_ async
@@ -329,12 +704,17 @@ namespace webservice{
 							throw std::logic_error("session doesn't exist");
 						}
 
+						// All handlers of the session have returned, so the
+						// value is no longer shared
 						try{
-							on_value_erase(identifier, std::move(iter->second));
+							on_value_erase(
+								identifier, std::move(iter->second.value));
 						}catch(...){
 							on_exception(identifier, std::current_exception());
 						}
 
+						impl_->keys_.erase(iter->second.key_slot);
+						impl_->tags_.erase(iter->second.tag_slot);
 						impl_->map_.erase(iter);
 
 						// note shutdown_ is used, not is_shutdown()
@@ -344,7 +724,43 @@ namespace webservice{
 					}catch(...){
 						on_exception(identifier, std::current_exception());
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
+		}
+
+
+		/// \brief Call fn with a reference to the value of identifier
+		///
+		/// This gives synchronous access to the value without a hop to the
+		/// service strand. The value is locked while fn runs, so it is safe
+		/// against concurrent modify_value() calls and value predicates of
+		/// send_text_if(), send_binary_if() and close_if(). These take the
+		/// lock only for sessions whose value was accessed by with_value()
+		/// before.
+		///
+		/// If ws_session_key_t is specialized for Value and fn changed the
+		/// key, the session is reindexed async.
+		///
+		/// \attention Must only be called from a handler of the session
+		///            identifier (on_open, on_text, on_binary, ...) where the
+		///            session is guaranteed to exist. Must not be called
+		///            recursively and not from the on_text/on_binary overloads
+		///            with a Value& parameter, which already hold the lock.
+		///            fn must not block on the service strand.
+		template < typename Fn >
+		auto with_value(ws_identifier identifier, Fn&& fn)
+			-> decltype(fn(std::declval< Value& >()))
+		{
+			assert(identifier.session->service_data_ != nullptr);
+
+			auto& data = *static_cast< entry* >(
+				identifier.session->service_data_);
+			if(!data.shared.load(std::memory_order_relaxed)){
+				share_value(data);
+			}
+
+			std::unique_lock< std::mutex > value_lock(data.mutex);
+			key_check check(*this, identifier, data, value_lock);
+			return static_cast< Fn&& >(fn)(data.value);
 		}
 
 
@@ -357,7 +773,9 @@ namespace webservice{
 		/// \brief Create a new session async
 		///
 		/// Call this function from your on_server_connect() overriding
-		/// function to create a new websocket server session.
+		/// function to create a new websocket server session. It takes the
+		/// admission ticket of the call and keeps it until the session
+		/// counted itself.
 		template < typename ... ValueArgs >
 		void async_server_connect(
 			boost::asio::ip::tcp::socket&& socket,
@@ -372,7 +790,9 @@ namespace webservice{
 					lock = locker_.make_lock(),
 					socket = std::move(socket),
 					req = std::move(req),
-					args = std::make_tuple(static_cast< ValueArgs&& >(args) ...)
+					args = std::make_tuple(
+						static_cast< ValueArgs&& >(args) ...),
+					ticket = take_admission_ticket()
 				]()mutable noexcept{
 					try{
 						if(is_shutdown()){
@@ -380,6 +800,14 @@ namespace webservice{
 								"emplace in ws_service_base while shutdown");
 						}
 
+						if(
+							max_sessions() != 0 &&
+							impl_->map_.size() >= max_sessions()
+						){
+							reject(std::move(socket), req);
+							return;
+						}
+
 						ws_stream ws(std::move(socket));
 						ws.read_message_max(max_read_message_size());
 
@@ -390,6 +818,24 @@ namespace webservice{
 
 						ws_identifier identifier(
 							strip_const(iter.first->first));
+						try{
+							impl_->tags_.insert(*identifier.session, 0,
+								iter.first->second.tag_slot);
+						}catch(...){
+							impl_->map_.erase(iter.first);
+							throw;
+						}
+
+						identifier.session->service_data_ = &iter.first->second;
+
+						update_key(iter.first->first, iter.first->second);
+
+						if(!subprotocols().empty()){
+							identifier.session->subprotocol_ =
+								select_subprotocol(req[boost::beast::http::
+									field::sec_websocket_protocol]);
+						}
+
 						try{
 							identifier.session->do_accept(std::move(req));
 						}catch(...){
@@ -399,7 +845,7 @@ namespace webservice{
 					}catch(...){
 						on_exception(std::current_exception());
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 
@@ -435,7 +881,8 @@ namespace webservice{
 							executor().get_io_context());
 						auto results = resolver.resolve(host, port);
 
-						ws_stream ws(executor().get_io_context());
+						// Place the session like an accepted one
+						ws_stream ws(executor().ws_io_context());
 						ws.read_message_max(max_read_message_size());
 
 						// Make the session on the IP address we get from a
@@ -453,6 +900,18 @@ namespace webservice{
 
 						ws_identifier identifier(
 							strip_const(iter.first->first));
+						try{
+							impl_->tags_.insert(*identifier.session, 0,
+								iter.first->second.tag_slot);
+						}catch(...){
+							impl_->map_.erase(iter.first);
+							throw;
+						}
+
+						identifier.session->service_data_ = &iter.first->second;
+
+						update_key(iter.first->first, iter.first->second);
+
 						try{
 							identifier.session->start();
 						}catch(...){
@@ -462,7 +921,7 @@ namespace webservice{
 					}catch(...){
 						on_exception(std::current_exception());
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 
 
@@ -506,6 +965,61 @@ namespace webservice{
 			}
 		};
 
+		/// \brief Answer a WebSocket upgrade request with HTTP 503
+		///
+		/// The response is written async on the io_context of the socket, so
+		/// a slow client can not stall the service strand. The write is the
+		/// only operation on the socket, so it needs no strand.
+		void reject(
+			boost::asio::ip::tcp::socket&& socket,
+			http_request const& req
+		){
+			struct rejection{
+				boost::asio::ip::tcp::socket socket;
+				http_string_response response;
+			};
+
+			auto data = std::make_shared< rejection >(rejection{
+				std::move(socket), service_unavailable(req,
+					executor().admission().retry_after())});
+			auto& ref = *data;
+			boost::beast::http::async_write(ref.socket, ref.response,
+				bind_recycling_allocator(
+					[lock = locker_.make_lock(), data](
+						boost::system::error_code ec,
+						std::size_t /*bytes_transferred*/
+					){
+						using tcp_socket = boost::asio::ip::tcp::socket;
+						data->socket.shutdown(tcp_socket::shutdown_both, ec);
+						data->socket.close(ec);
+					}));
+		}
+
+		/// \brief Type of the session index key
+		template < typename V >
+		using key_type = typename detail::ws_key_index< V >::key_type;
+
+		/// \brief Reserve space if the message count is known in advance
+		template < typename Iterator >
+		static void reserve_batch(
+			ws_send_batch& batch,
+			Iterator first,
+			Iterator last,
+			std::forward_iterator_tag
+		){
+			batch.reserve(static_cast< std::size_t >(
+				std::distance(first, last)));
+		}
+
+		/// \brief Input iterator ranges can only be traversed once
+		template < typename Iterator >
+		static void reserve_batch(
+			ws_send_batch&,
+			Iterator,
+			Iterator,
+			std::input_iterator_tag
+		){}
+
 		/// \brief Called when all sessions have been erased after shutdown
 		///
 		/// Default implementation calls shutdown_finished(). Override it, if
@@ -525,16 +1039,188 @@ namespace webservice{
 			return const_cast< ws_session& >(session);
 		}
 
+		/// \brief Data linked to a session
+		struct entry{
+			/// \brief Construct value with args
+			template < typename ... ValueArgs >
+			entry(ValueArgs&& ... args)
+				: value(static_cast< ValueArgs&& >(args) ...) {}
+
+			/// \brief The user data
+			Value value;
+
+			/// \brief Locked on every access to value once shared is true
+			std::mutex mutex;
+
+			/// \brief true after the first with_value() call, set once
+			std::atomic< bool > shared{false};
+
+			/// \brief Index of the session in impl::tags_
+			std::size_t tag_slot;
+
+			/// \brief Key of the session in impl::keys_
+			typename detail::ws_key_index< Value >::slot key_slot;
+		};
+
 		/// \brief Implementation data after the executor was set
 		struct impl{
 			impl(boost::asio::io_context::executor_type&& executor)
 				: strand_(std::move(executor)) {}
 
 			strand strand_;
-			std::map< ws_session, Value, less > map_;
+			std::map< ws_session, entry, less > map_;
+			ws_tag_index tags_;
+			detail::ws_key_index< Value > keys_;
+
+			/// \brief Odd while a value_section is active on strand_
+			std::atomic< std::size_t > value_sections_{0};
+
+			/// \brief Nesting depth of value_section, used on strand_ only
+			std::size_t value_section_depth_{0};
+		};
+
+
+		/// \brief Marks the value accesses of strand_
+		///
+		/// with_value() sets entry::shared and waits for the active section,
+		/// which might have read entry::shared before, so every value access
+		/// of strand_ is either locked or finished before with_value() locks.
+		class value_section{
+		public:
+			explicit value_section(impl& data)noexcept
+				: impl_(data)
+			{
+				if(impl_.value_section_depth_++ == 0){
+					impl_.value_sections_.fetch_add(1);
+				}
+			}
+
+			value_section(value_section const&) = delete;
+
+			value_section& operator=(value_section const&) = delete;
+
+			~value_section(){
+				if(--impl_.value_section_depth_ == 0){
+					impl_.value_sections_.fetch_add(1,
+						std::memory_order_release);
+				}
+			}
+
+
+		private:
+			impl& impl_;
+		};
+
+
+		/// \brief Lock data.mutex if the value is shared with with_value()
+		///
+		/// Must be called in a value_section.
+		static std::unique_lock< std::mutex > lock_value(entry& data){
+			return data.shared.load()
+				? std::unique_lock< std::mutex >(data.mutex)
+				: std::unique_lock< std::mutex >();
+		}
+
+		/// \brief Make strand_ lock data.mutex from now on
+		void share_value(entry& data)noexcept{
+			data.shared.store(true);
+			auto const sections = impl_->value_sections_.load();
+			if(sections % 2 != 0){
+				while(
+					impl_->value_sections_.load(std::memory_order_acquire)
+						== sections
+				){
+					std::this_thread::yield();
+				}
+			}
+		}
+
+
+		/// \brief Reindex the session async if with_value() changed its key
+		class key_check{
+		public:
+			key_check(
+				ws_service_base& service,
+				ws_identifier identifier,
+				entry& data,
+				std::unique_lock< std::mutex >& value_lock
+			)noexcept
+				: service_(service)
+				, identifier_(identifier)
+				, data_(data)
+				, value_lock_(value_lock) {}
+
+			key_check(key_check const&) = delete;
+
+			key_check& operator=(key_check const&) = delete;
+
+			~key_check(){
+				try{
+					auto const current = detail::ws_key_index< Value >::
+						is_current(data_.value, data_.key_slot);
+					value_lock_.unlock();
+					if(!current){
+						service_.async_update_key(identifier_);
+					}
+				}catch(...){
+					service_.on_exception(identifier_,
+						std::current_exception());
+				}
+			}
+
+
+		private:
+			ws_service_base& service_;
+			ws_identifier identifier_;
+			entry& data_;
+			std::unique_lock< std::mutex >& value_lock_;
 		};
 
 
+		/// \brief Call fn(identifier, data.value) with data.mutex locked if
+		///        the value is shared
+		///
+		/// Must be called in a value_section.
+		template < typename Fn >
+		static bool call_locked(
+			entry& data,
+			Fn& fn,
+			ws_identifier identifier
+		){
+			auto value_lock = lock_value(data);
+			return fn(identifier, data.value);
+		}
+
+
+		/// \brief Reindex session by the key of its value
+		///
+		/// Errors are reported via on_exception, the session stays
+		/// unindexed in this case.
+		void update_key(ws_session const& session, entry& data)noexcept{
+			try{
+				impl_->keys_.update(
+					strip_const(session), data.value, data.key_slot);
+			}catch(...){
+				on_exception(ws_identifier(strip_const(session)),
+					std::current_exception());
+			}
+		}
+
+
+		/// \brief Reindex identifier by the key of its value async
+		void async_update_key(ws_identifier identifier){
+			impl_->strand_.dispatch(
+				[this, lock = locker_.make_lock(), identifier]()noexcept{
+					auto iter = impl_->map_.find(identifier);
+					if(iter != impl_->map_.end()){
+						value_section section(*impl_);
+						auto value_lock = lock_value(iter->second);
+						update_key(iter->first, iter->second);
+					}
+				}, recycling_allocator< void >());
+		}
+
+
 		/// \brief true after on_shutdown async has finished
 		///
 		/// \attention This is not equivalent with is_shutdown().
@@ -11,17 +11,23 @@
 
 #include "async_locker.hpp"
 #include "shared_const_buffer.hpp"
+#include "handler_allocator.hpp"
 
 #include <boost/beast/websocket.hpp>
+#include <boost/beast/core/multi_buffer.hpp>
 
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/steady_timer.hpp>
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <memory>
 #include <chrono>
+#include <string>
+#include <vector>
 
 
 namespace webservice{
@@ -38,6 +44,94 @@ namespace webservice{
 
 
 	class ws_service_interface;
+	class ws_session;
+
+
+	/// \brief A message of a send_many() call
+	struct ws_batch_message{
+		/// \brief Receiver
+		ws_session* session;
+
+		/// \brief Send as text or as binary message
+		bool is_text;
+
+		/// \brief Message data
+		shared_const_buffer data;
+	};
+
+	/// \brief Messages of a send_many() call, sorted by session
+	using ws_send_batch = std::vector< ws_batch_message,
+		recycling_allocator< ws_batch_message > >;
+
+
+	/// \brief Called once when a message was written or dropped
+	///
+	/// The function gets an empty error_code after the message was written
+	/// and the write error otherwise. A message that is destroyed unwritten,
+	/// e.g. because the session closed, gets operation_aborted.
+	///
+	/// The function runs on the internal strand of the session or in its
+	/// destructor. It must not block and must not call the session, post
+	/// further work to an executor instead.
+	class ws_write_handler{
+	public:
+		/// \brief Type of the called function
+		using function = void(*)(void* context, boost::system::error_code ec);
+
+
+		/// \brief No function
+		ws_write_handler()noexcept = default;
+
+		/// \brief Call fn(context, ec) on completion
+		ws_write_handler(function fn, void* context)noexcept
+			: fn_(fn)
+			, context_(context) {}
+
+		ws_write_handler(ws_write_handler const&) = delete;
+
+		ws_write_handler(ws_write_handler&& other)noexcept
+			: fn_(other.fn_)
+			, context_(other.context_)
+		{
+			other.fn_ = nullptr;
+		}
+
+		/// \brief Call the function with operation_aborted if not done
+		~ws_write_handler(){
+			(*this)(boost::asio::error::operation_aborted);
+		}
+
+
+		ws_write_handler& operator=(ws_write_handler const&) = delete;
+
+		ws_write_handler& operator=(ws_write_handler&& other)noexcept{
+			if(this != &other){
+				(*this)(boost::asio::error::operation_aborted);
+				fn_ = other.fn_;
+				context_ = other.context_;
+				other.fn_ = nullptr;
+			}
+			return *this;
+		}
+
+
+		/// \brief Call the function if it was not called before
+		void operator()(boost::system::error_code ec)noexcept{
+			if(fn_){
+				auto const fn = fn_;
+				fn_ = nullptr;
+				fn(context_, ec);
+			}
+		}
+
+
+	private:
+		/// \brief The function, nullptr after it was called
+		function fn_{nullptr};
+
+		/// \brief First argument of fn_
+		void* context_{nullptr};
+	};
 
 
 	/// \brief Base of WebSocket sessions
@@ -68,12 +162,38 @@ namespace webservice{
 
 
 		/// \brief Send a message
-		void send(bool is_text, shared_const_buffer buffer)noexcept;
+		///
+		/// The message is pushed to a lock-free queue. Only the call that
+		/// finds the queue empty schedules the writer on the strand.
+		///
+		/// handler is called when the message was written or dropped.
+		void send(
+			bool is_text,
+			shared_const_buffer buffer,
+			ws_write_handler handler = ws_write_handler())noexcept;
+
+		/// \brief Send the messages [first, last) of batch in order
+		///
+		/// All messages in the range must have this session as receiver. The
+		/// range is queued as one entry like a single message.
+		void send(
+			std::shared_ptr< ws_send_batch const > batch,
+			std::size_t first,
+			std::size_t last)noexcept;
 
 		/// \brief Close the session
+		///
+		/// Messages that were sent before are written first, later ones are
+		/// dropped.
 		void close(boost::beast::websocket::close_reason reason)noexcept;
 
 
+		/// \brief Negotiated WebSocket subprotocol, empty if none
+		std::string const& subprotocol()const noexcept{
+			return subprotocol_;
+		}
+
+
 	private:
 		/// \brief Async wait on timer
 		///
@@ -105,6 +225,20 @@ namespace webservice{
 		/// \brief Send the next outstanding message or close
 		void do_write();
 
+
+		/// \brief Entry of the send queue
+		struct send_node;
+
+		/// \brief Push node to the send queue
+		///
+		/// Schedules drain_send_queue() if the queue was empty.
+		void push_send(send_node* node, async_locker::lock&& lock);
+
+		/// \brief Move all queued messages to the write list
+		///
+		/// Must be called on strand_.
+		void drain_send_queue();
+
 		/// \brief Initiate the first timer call
 		void start_timer();
 
@@ -134,6 +268,7 @@ namespace webservice{
 		struct write_data{
 			bool is_text;
 			shared_const_buffer data;
+			ws_write_handler handler;
 		};
 
 
@@ -158,6 +293,12 @@ namespace webservice{
 		/// \brief Write queue
 		boost::circular_buffer< write_data > write_list_;
 
+		/// \brief Lock-free send queue, the newest entry first
+		///
+		/// Producers push with a compare exchange, the writer takes all
+		/// entries at once with an exchange.
+		std::atomic< send_node* > send_queue_{nullptr};
+
 		/// \brief Optional close reason
 		std::unique_ptr< boost::beast::websocket::close_reason > close_reason_;
 
@@ -173,8 +314,18 @@ namespace webservice{
 		/// \brief Ping flag
 		bool wait_on_pong_{false};
 
+		/// \brief Per session data of the owning ws_service_base
+		void* service_data_{nullptr};
+
 		/// \brief true after is_open() call
 		bool is_open_{false};
+
+		/// \brief Negotiated WebSocket subprotocol, set before do_accept()
+		std::string subprotocol_;
+
+
+		template < typename Value >
+		friend class ws_service_base;
 	};
 
 
@@ -0,0 +1,163 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__ws_session_key__hpp_INCLUDED_
+#define _webservice__ws_session_key__hpp_INCLUDED_
+
+#include <boost/optional.hpp>
+
+#include <unordered_map>
+#include <type_traits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace webservice{
+
+
+	class ws_session;
+
+
+	/// \brief Specialize this to index the sessions of a ws_service_base by a
+	///        key extracted from their Value
+	///
+	/// The specialization must have a const function operator that takes a
+	/// Value const& and returns the key or a boost::optional of the key. An
+	/// empty optional means that the session is not indexed. The key must be
+	/// unique over all sessions of a service and usable in an
+	/// std::unordered_map.
+	template < typename Value >
+	struct ws_session_key_t{};
+
+
+	namespace detail{
+
+
+		template < typename Value, typename = void >
+		struct has_session_key: std::false_type{};
+
+		template < typename Value >
+		struct has_session_key< Value,
+				decltype((void)std::declval< ws_session_key_t< Value > const >()(
+					std::declval< Value const& >())) >
+			: std::true_type{};
+
+
+		template < typename T >
+		struct unwrap_optional{
+			using type = T;
+
+			template < typename U >
+			static boost::optional< T > get(U&& key){
+				return boost::optional< T >(static_cast< U&& >(key));
+			}
+		};
+
+		template < typename T >
+		struct unwrap_optional< boost::optional< T > >{
+			using type = T;
+
+			template < typename U >
+			static boost::optional< T > get(U&& key){
+				return static_cast< U&& >(key);
+			}
+		};
+
+
+		/// \brief Hash index from key to session, does nothing if Value has
+		///        no ws_session_key_t specialization
+		template < typename Value, bool = has_session_key< Value >::value >
+		class ws_key_index{
+		public:
+			/// \brief Stored per session
+			struct slot{};
+
+			void update(ws_session&, Value const&, slot&){}
+
+			void erase(slot&)noexcept{}
+
+			static constexpr bool is_current(Value const&, slot const&)noexcept{
+				return true;
+			}
+		};
+
+		template < typename Value >
+		class ws_key_index< Value, true >{
+			using extract_result = typename std::decay< decltype(
+				std::declval< ws_session_key_t< Value > const >()(
+					std::declval< Value const& >())) >::type;
+
+			using unwrap = unwrap_optional< extract_result >;
+
+		public:
+			/// \brief Type of the key
+			using key_type = typename unwrap::type;
+
+			/// \brief Stored per session, the key under which it is indexed
+			using slot = boost::optional< key_type >;
+
+
+			/// \brief Reindex session after value was constructed or modified
+			///
+			/// \throw std::logic_error if the new key is already in use by
+			///                         another session; the session is not
+			///                         indexed in this case
+			void update(ws_session& session, Value const& value, slot& key){
+				ws_session_key_t< Value > const extract{};
+				auto new_key = unwrap::get(extract(value));
+				if(new_key == key){
+					return;
+				}
+
+				erase(key);
+
+				if(!new_key){
+					return;
+				}
+
+				if(!map_.emplace(*new_key, &session).second){
+					throw std::logic_error("session key already in use");
+				}
+
+				key = std::move(new_key);
+			}
+
+			/// \brief true if key is the key of value
+			static bool is_current(Value const& value, slot const& key){
+				ws_session_key_t< Value > const extract{};
+				return unwrap::get(extract(value)) == key;
+			}
+
+			/// \brief Remove the session from the index
+			void erase(slot& key)noexcept{
+				if(key){
+					map_.erase(*key);
+					key = boost::none;
+				}
+			}
+
+			/// \brief Session with key or nullptr
+			ws_session* find(key_type const& key)const{
+				auto iter = map_.find(key);
+				return iter != map_.end() ? iter->second : nullptr;
+			}
+
+
+		private:
+			/// \brief Map from key to session
+			std::unordered_map< key_type, ws_session* > map_;
+		};
+
+
+	}
+
+
+}
+
+
+#endif
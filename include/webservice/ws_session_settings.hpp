@@ -9,7 +9,12 @@
 #ifndef _webservice__ws_session_settings__hpp_INCLUDED_
 #define _webservice__ws_session_settings__hpp_INCLUDED_
 
+#include <boost/utility/string_view.hpp>
+
 #include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
 
 
 namespace webservice{
@@ -40,6 +45,40 @@ namespace webservice{
 		}
 
 
+		/// \brief Set max count of sessions, 0 means no limit
+		///
+		/// Further server sessions are rejected with HTTP 503.
+		void set_max_sessions(std::size_t count){
+			max_sessions_ = count;
+		}
+
+		/// \brief Max count of sessions, 0 means no limit
+		std::size_t max_sessions()const{
+			return max_sessions_;
+		}
+
+
+		/// \brief Set the supported WebSocket subprotocols
+		///
+		/// The order is the server preference. A server session uses the
+		/// first one that is also offered by the client in its
+		/// Sec-WebSocket-Protocol header. If none matches, the session has
+		/// no subprotocol.
+		void set_subprotocols(std::vector< std::string > protocols){
+			subprotocols_ = std::move(protocols);
+		}
+
+		/// \brief The supported WebSocket subprotocols
+		std::vector< std::string > const& subprotocols()const{
+			return subprotocols_;
+		}
+
+		/// \brief First supported subprotocol in offered, empty if none
+		///
+		/// offered is the value of a Sec-WebSocket-Protocol header.
+		std::string select_subprotocol(boost::string_view offered)const;
+
+
 	private:
 		/// \brief Max size of incomming http and WebSocket messages
 		std::size_t max_read_message_size_{16 * 1024 * 1024};
@@ -50,6 +89,12 @@ namespace webservice{
 		/// If no message is incomming after a second period of this time, the
 		/// session is considerd to be dead and will be closed.
 		std::chrono::milliseconds ping_time_{15000};
+
+		/// \brief Max count of sessions, 0 means no limit
+		std::size_t max_sessions_{0};
+
+		/// \brief Supported WebSocket subprotocols in preference order
+		std::vector< std::string > subprotocols_;
 	};
 
 
@@ -0,0 +1,138 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#ifndef _webservice__ws_tag_index__hpp_INCLUDED_
+#define _webservice__ws_tag_index__hpp_INCLUDED_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+namespace webservice{
+
+
+	class ws_session;
+
+
+	/// \brief How the tag word of a session is compared with a mask
+	enum class tag_match{
+		/// \brief At least one bit of the mask is set
+		any,
+
+		/// \brief All bits of the mask are set
+		all,
+
+		/// \brief No bit of the mask is set
+		none
+	};
+
+
+	/// \brief Selects sessions by their 64 bit tag word
+	struct tag_filter{
+		/// \brief Bits that are tested
+		std::uint64_t mask;
+
+		/// \brief How the masked bits must look like
+		tag_match mode;
+	};
+
+
+	/// \brief Dense array of the tag words of all sessions of a service
+	///
+	/// The tags are stored contiguous, so a broadcast filter is a vectorized
+	/// scan over integers instead of a functor call per map node.
+	///
+	/// Thread safe: No.
+	class ws_tag_index{
+	public:
+		/// \brief Add a session
+		///
+		/// slot is set to the index of the session and updated whenever the
+		/// session is moved inside the index. It must stay valid until the
+		/// session is erased.
+		void insert(ws_session& session, std::uint64_t tags, std::size_t& slot);
+
+		/// \brief Remove the session at slot
+		void erase(std::size_t slot)noexcept;
+
+
+		/// \brief Tag word of the session at slot
+		std::uint64_t get(std::size_t slot)const noexcept{
+			return tags_[slot];
+		}
+
+		/// \brief Set the tag word of the session at slot
+		void set(std::size_t slot, std::uint64_t tags)noexcept{
+			tags_[slot] = tags;
+		}
+
+
+		/// \brief Count of sessions
+		std::size_t size()const noexcept{
+			return tags_.size();
+		}
+
+
+		/// \brief Call fn(session) for every session that matches filter
+		///
+		/// fn must not insert or erase sessions.
+		template < typename Fn >
+		void for_each_match(tag_filter filter, Fn&& fn)const{
+			std::size_t const count = tags_.size();
+			for(std::size_t base = 0; base < count; base += 64){
+				auto bits = match(tags_.data() + base,
+					std::min< std::size_t >(64, count - base), filter);
+				for(; bits != 0; bits &= bits - 1){
+					fn(*sessions_[base + lowest_bit(bits)]);
+				}
+			}
+		}
+
+
+		/// \brief Bit i of the result is set if tags[i] matches filter
+		///
+		/// \pre count <= 64
+		static std::uint64_t match(
+			std::uint64_t const* tags,
+			std::size_t count,
+			tag_filter filter)noexcept;
+
+
+	private:
+		/// \brief Index of the lowest set bit
+		///
+		/// \pre bits != 0
+		static std::size_t lowest_bit(std::uint64_t bits)noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+			return static_cast< std::size_t >(__builtin_ctzll(bits));
+#else
+			std::size_t index = 0;
+			for(; (bits & 1) == 0; bits >>= 1){
+				++index;
+			}
+			return index;
+#endif
+		}
+
+
+		/// \brief Tag words
+		std::vector< std::uint64_t > tags_;
+
+		/// \brief Session of the tag word with the same index
+		std::vector< ws_session* > sessions_;
+
+		/// \brief Slot reference of the tag word with the same index
+		std::vector< std::size_t* > slots_;
+	};
+
+
+}
+
+
+#endif
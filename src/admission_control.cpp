@@ -0,0 +1,54 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/admission_control.hpp>
+
+
+namespace webservice{
+
+
+	admission_control::ticket admission_control::admit()noexcept{
+		auto const max_lag = max_executor_lag();
+		if(max_lag.count() != 0 && executor_lag() > max_lag){
+			return ticket();
+		}
+
+		if(!reserve(sessions_, max_sessions())){
+			return ticket();
+		}
+
+		if(!reserve(handshakes_, max_handshakes())){
+			sessions_.fetch_sub(1, std::memory_order_relaxed);
+			return ticket();
+		}
+
+		return ticket(*this);
+	}
+
+	bool admission_control::reserve(
+		std::atomic< std::size_t >& count,
+		std::size_t const max
+	)noexcept{
+		if(max == 0){
+			count.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		auto value = count.load(std::memory_order_relaxed);
+		do{
+			if(value >= max){
+				return false;
+			}
+		}while(!count.compare_exchange_weak(value, value + 1,
+			std::memory_order_relaxed));
+
+		return true;
+	}
+
+
+}
@@ -17,15 +17,34 @@ namespace webservice{
 	client::client(
 		std::unique_ptr< ws_handler_interface > ws_handler,
 		std::unique_ptr< error_handler > error_handler,
-		std::uint8_t const thread_count
+		std::size_t const thread_count,
+		thread_options options
 	)
-		: ioc_{thread_count}
+		: own_ioc_(std::make_unique< boost::asio::io_context >(
+				executor::concurrency_hint(thread_count, options)))
+		, ioc_(*own_ioc_)
 		, impl_(std::make_unique< client_impl >(
 				*this,
 				ioc_,
 				std::move(ws_handler),
 				std::move(error_handler),
-				thread_count
+				thread_count,
+				std::move(options)
+			)) {}
+
+	client::client(
+		std::unique_ptr< ws_handler_interface > ws_handler,
+		std::unique_ptr< error_handler > error_handler,
+		boost::asio::io_context& ioc
+	)
+		: ioc_(ioc)
+		, impl_(std::make_unique< client_impl >(
+				*this,
+				ioc_,
+				std::move(ws_handler),
+				std::move(error_handler),
+				0,
+				thread_options()
 			)) {}
 
 
@@ -57,6 +76,15 @@ namespace webservice{
 	}
 
 
+	void client::resize(std::size_t const thread_count){
+		impl_->executor().resize(thread_count);
+	}
+
+	executor_stats client::stats(){
+		return impl_->executor().stats();
+	}
+
+
 	boost::asio::io_context& client::get_io_context()noexcept{
 		return ioc_;
 	}
@@ -21,11 +21,12 @@ namespace webservice{
 		boost::asio::io_context& ioc,
 		std::unique_ptr< ws_handler_interface >&& ws_handler,
 		std::unique_ptr< error_handler >&& error_handler,
-		std::uint8_t thread_count
+		std::size_t thread_count,
+		thread_options options
 	)
 		: client_(client)
 		, executor_(ioc, std::move(error_handler), [this]()noexcept{
-				ws().shutdown();
+				ws().shutdown([this]()noexcept{ ws_lock_.unlock(); });
 				work_.reset();
 			})
 		, ws_handler_(std::move(ws_handler))
@@ -37,8 +38,9 @@ namespace webservice{
 		}
 
 		ws_handler_->set_executor(executor_);
+		ws_lock_ = executor_.make_lock();
 
-		executor_.run(thread_count);
+		executor_.run(thread_count, std::move(options));
 	}
 
 
@@ -29,12 +29,15 @@ namespace webservice{
 		///
 		/// \param service Handles ws sessions
 		/// \param error_handler Handles error in the client_impl
+		/// \param thread_count Count of own threads, 0 if the owner of ioc
+		///                     runs it
 		client_impl(
 			class client& client,
 			boost::asio::io_context& ioc,
 			std::unique_ptr< class ws_handler_interface >&& service,
 			std::unique_ptr< class error_handler >&& error_handler,
-			std::uint8_t thread_count
+			std::size_t thread_count,
+			thread_options options
 		);
 
 		client_impl(client_impl const&) = delete;
@@ -84,6 +87,9 @@ namespace webservice{
 		/// \brief Handler for WebSocket sessions
 		std::unique_ptr< class ws_handler_interface > ws_handler_;
 
+		/// \brief Keep the executor locked until ws_handler_ is shut down
+		async_locker::lock ws_lock_;
+
 		/// \brief Keeps the io_context running
 		boost::asio::executor_work_guard<
 			boost::asio::io_context::executor_type > work_;
@@ -7,37 +7,410 @@
 // file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
 //-----------------------------------------------------------------------------
 #include <webservice/executor.hpp>
+#include <webservice/handler_allocator.hpp>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+
+#include <boost/system/system_error.hpp>
+
+#include <boost/version.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 
 namespace webservice{
 
 
+	/// \brief Time between two executor lag measurements
+	constexpr auto probe_interval = std::chrono::milliseconds(100);
+
+
 	executor::~executor(){
 		assert(threads_.empty());
 	}
 
-	void executor::run(std::uint8_t thread_count){
+	void executor::run(
+		std::size_t const thread_count,
+		thread_options options
+	){
+		if(thread_count == 0){
+			if(
+				options.placement != session_placement::shared ||
+				options.max_threads > 0 ||
+				options.ws_threads > 0 ||
+				options.blocking_threads > 0
+			){
+				throw std::logic_error(
+					"executor without own threads can't apply thread_options");
+			}
+
+			external_ = true;
+		}
+
+		options_ = std::move(options);
+
+		// Keep the own threads running until shutdown, nothing else may be
+		// queued before the listener accepts
+		if(!external_){
+			thread_works_.push_back(boost::asio::make_work_guard(ioc_));
+		}
+
+		session_contexts_.push_back(&ioc_);
+		if(options_.placement != session_placement::shared){
+			for(std::size_t i = 1; i < thread_count; ++i){
+				// Every io_context is run by exactly one thread
+				thread_contexts_.push_back(
+					std::make_unique< boost::asio::io_context >(1));
+				auto& ioc = *thread_contexts_.back();
+				thread_works_.push_back(boost::asio::make_work_guard(ioc));
+				session_contexts_.push_back(&ioc);
+			}
+		}
+		session_counts_ = std::make_unique< std::atomic< std::size_t >[] >(
+			session_contexts_.size());
+
+		auto const make_context = [this](std::size_t const thread_count){
+				thread_contexts_.push_back(
+					std::make_unique< boost::asio::io_context >(
+						static_cast< int >(thread_count)));
+				auto& ioc = *thread_contexts_.back();
+				thread_works_.push_back(boost::asio::make_work_guard(ioc));
+				return &ioc;
+			};
+
+		if(options_.ws_threads > 0){
+			ws_context_ = make_context(options_.ws_threads);
+		}
+
+		if(options_.blocking_threads > 0){
+			blocking_context_ = make_context(options_.blocking_threads);
+		}
+
+		if(
+			options_.measure_lag ||
+			options_.max_threads > 0 ||
+			admission_.max_executor_lag().count() != 0
+		){
+			start_probe();
+		}
+
 		// Run the I/O service on the requested number of thread_count
-		threads_.reserve(thread_count);
+		std::lock_guard< std::mutex > lock(mutex_);
+		threads_.reserve(thread_count +
+			options_.ws_threads + options_.blocking_threads);
 		for(std::size_t i = 0; i < thread_count; ++i){
-			threads_.emplace_back([this]{
-				// restart io_context if it returned by exception
-				for(;;){
-					try{
-						ioc_.run();
-						return;
-					}catch(...){
-						error_handler_->on_exception(std::current_exception());
-					}
+			start_thread(options_.placement == session_placement::shared
+				? ioc_ : *session_contexts_[i]);
+		}
+		thread_count_ = thread_count;
+		max_thread_count_ = static_cast< std::size_t >(
+			concurrency_hint(thread_count, options_));
+
+		for(std::size_t i = 0; i < options_.ws_threads; ++i){
+			start_thread(*ws_context_);
+		}
+
+		for(std::size_t i = 0; i < options_.blocking_threads; ++i){
+			start_thread(*blocking_context_);
+		}
+	}
+
+	void executor::resize(std::size_t const thread_count){
+		if(options_.placement != session_placement::shared){
+			throw std::logic_error(
+				"executor::resize() requires session_placement::shared");
+		}
+
+		if(thread_count == 0){
+			throw std::logic_error("executor::resize() to 0 threads");
+		}
+
+		if(external_){
+			throw std::logic_error(
+				"executor::resize() without own threads");
+		}
+
+		std::vector< std::thread > finished;
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			if(is_shutdown_){
+				return;
+			}
+
+			// Take the threads that returned after former calls
+			for(auto const id: retired_){
+				auto const iter = std::find_if(threads_.begin(),
+					threads_.end(), [id](std::thread const& thread){
+						return thread.get_id() == id;
+					});
+				if(iter != threads_.end()){
+					finished.push_back(std::move(*iter));
+					threads_.erase(iter);
 				}
+			}
+			retired_.clear();
+
+			if(thread_count > max_thread_count_){
+				throw std::logic_error(
+					"executor::resize() above the concurrency hint");
+			}
+
+			set_thread_count(thread_count);
+		}
+
+		for(auto& thread: finished){
+			thread.join();
+		}
+	}
+
+	void executor::set_thread_count(std::size_t const thread_count){
+		// Cancel pending retirements before new threads are started
+		for(auto retire = retire_count_.load(std::memory_order_relaxed);
+			thread_count_ < thread_count && retire > 0;
+		){
+			if(retire_count_.compare_exchange_weak(retire, retire - 1,
+				std::memory_order_relaxed)
+			){
+				++thread_count_;
+				--retire;
+			}
+		}
+
+		for(; thread_count_ < thread_count; ++thread_count_){
+			start_thread(ioc_);
+		}
+
+		// The empty handler wakes a waiting thread to claim the retirement
+		for(; thread_count_ > thread_count; --thread_count_){
+			retire_count_.fetch_add(1, std::memory_order_relaxed);
+			boost::asio::post(ioc_, []{});
+		}
+	}
+
+	std::size_t executor::thread_count()noexcept{
+		std::lock_guard< std::mutex > lock(mutex_);
+		return thread_count_;
+	}
+
+	int executor::concurrency_hint(
+		std::size_t const thread_count,
+		thread_options const& options
+	)noexcept{
+		if(options.placement != session_placement::shared){
+			return 1;
+		}
+
+		auto const count = std::max(thread_count, options.max_threads);
+		return static_cast< int >(std::min< std::size_t >(count,
+			std::numeric_limits< int >::max()));
+	}
+
+	void executor::start_thread(boost::asio::io_context& ioc){
+		auto const index = next_thread_index_++;
+		threads_.emplace_back([this, &ioc, index]{
+				setup_thread(index);
+				run_io_context(ioc, index);
 			});
+	}
+
+	void executor::run_io_context(
+		boost::asio::io_context& ioc,
+		std::size_t const index
+	){
+		detail::thread_counters counters(index);
+		{
+			std::lock_guard< std::mutex > lock(stats_mutex_);
+			thread_counters_.push_back(&counters);
 		}
+
+		// Only threads of the shared ioc_ retire
+		auto const retire = &ioc == &ioc_ &&
+			options_.placement == session_placement::shared
+			? &retire_count_ : nullptr;
+
+		// restart io_context if it returned by exception
+		for(bool running = true; running;){
+			try{
+				if(run_counted(ioc, counters, retire)){
+					std::lock_guard< std::mutex > lock(mutex_);
+					retired_.push_back(std::this_thread::get_id());
+				}
+				running = false;
+			}catch(...){
+				error_handler_->on_exception(std::current_exception());
+			}
+		}
+
+		std::lock_guard< std::mutex > lock(stats_mutex_);
+		thread_counters_.erase(std::find(thread_counters_.begin(),
+			thread_counters_.end(), &counters));
 	}
 
+	bool executor::run_counted(
+		boost::asio::io_context& ioc,
+		detail::thread_counters& counters,
+		std::atomic< std::size_t >* const retire
+	){
+		using clock = std::chrono::steady_clock;
 
-	void executor::block()noexcept{
+		// Only this thread writes the counters
+		auto const add = [](
+			std::atomic< std::uint64_t >& counter,
+			clock::duration time
+		){
+			counter.store(counter.load(std::memory_order_relaxed) +
+				static_cast< std::uint64_t >(std::chrono::duration_cast<
+					std::chrono::nanoseconds >(time).count()),
+				std::memory_order_relaxed);
+		};
+
+		// Claim one of the requested retirements
+		auto const retired = [retire]{
+				if(retire == nullptr){
+					return false;
+				}
+
+				auto count = retire->load(std::memory_order_relaxed);
+				while(count > 0){
+					if(retire->compare_exchange_weak(count, count - 1,
+						std::memory_order_relaxed)
+					){
+						return true;
+					}
+				}
+				return false;
+			};
+
+		for(;;){
+			// A ready handler is busy time
+			auto start = clock::now();
+			if(ioc.poll_one() != 0){
+				add(counters.busy, clock::now() - start);
+				counters.handlers.store(
+					counters.handlers.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+				if(retired()){
+					return true;
+				}
+				continue;
+			}
+
+			// Otherwise wait, the handler after the wait counts as idle
+			start = clock::now();
+			auto const count = ioc.run_one();
+			add(counters.idle, clock::now() - start);
+			if(count == 0){
+				return false;
+			}
+			counters.handlers.store(
+				counters.handlers.load(std::memory_order_relaxed) + count,
+				std::memory_order_relaxed);
+			if(retired()){
+				return true;
+			}
+		}
+	}
+
+	void executor::adapt_thread_count(
+		std::chrono::milliseconds const lag
+	)noexcept try{
+		if(
+			options_.max_threads == 0 ||
+			options_.placement != session_placement::shared
+		){
+			return;
+		}
+
+		// Runs in a handler, retired threads are joined by resize() or
+		// block()
 		std::lock_guard< std::mutex > lock(mutex_);
-		for(auto& thread: threads_){
+		if(is_shutdown_){
+			return;
+		}
+
+		auto const count = thread_count_;
+		if(lag > options_.grow_lag){
+			calm_probes_ = 0;
+			if(count < options_.max_threads){
+				set_thread_count(count + 1);
+			}
+		}else if(lag < options_.shrink_lag){
+			auto const min_threads =
+				std::max< std::size_t >(options_.min_threads, 1);
+			if(
+				++calm_probes_ * probe_interval >= options_.shrink_delay &&
+				count > min_threads
+			){
+				calm_probes_ = 0;
+				set_thread_count(count - 1);
+			}
+		}else{
+			calm_probes_ = 0;
+		}
+	}catch(...){
+		error_handler_->on_exception(std::current_exception());
+	}
+
+
+	void executor::setup_thread(std::size_t const index)noexcept{
+#ifdef __linux__
+		if(!options_.cpus.empty()){
+			auto const& cpus = options_.cpus[index % options_.cpus.size()];
+
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for(auto const cpu: cpus){
+				if(cpu < CPU_SETSIZE){
+					CPU_SET(cpu, &set);
+				}
+			}
+
+			auto const result =
+				pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			if(result != 0){
+				error_handler_->on_exception(std::make_exception_ptr(
+					boost::system::system_error(result,
+						boost::system::system_category(),
+						"executor thread affinity")));
+			}
+		}
+
+		if(!options_.name.empty()){
+			// Linux allows 15 characters plus terminating null
+			auto const suffix = ":" + std::to_string(index);
+			auto const name =
+				options_.name.substr(0, 15 - suffix.size()) + suffix;
+			pthread_setname_np(pthread_self(), name.c_str());
+		}
+#else
+		(void)index;
+#endif
+	}
+
+
+	void executor::block()noexcept{
+		// Don't hold the lock while joining, a thread may call resize()
+		for(;;){
+			std::thread thread;
+			{
+				std::lock_guard< std::mutex > lock(mutex_);
+				if(threads_.empty()){
+					retired_.clear();
+					break;
+				}
+
+				thread = std::move(threads_.back());
+				threads_.pop_back();
+			}
+
 			if(thread.joinable()){
 				try{
 					thread.join();
@@ -47,15 +420,150 @@ namespace webservice{
 			}
 		}
 
-		threads_.clear();
+		// Other threads run the io_context, wait for their async operations
+		if(external_){
+			std::unique_lock< std::mutex > lock(locks_mutex_);
+			locks_cv_.wait(lock, [this]{ return locks_released_; });
+		}
 	}
 
 	bool executor::is_stopped()noexcept{
+		if(external_){
+			std::lock_guard< std::mutex > lock(locks_mutex_);
+			return locks_released_;
+		}
+
+		for(auto const& ioc: thread_contexts_){
+			if(!ioc->stopped()){
+				return false;
+			}
+		}
+
 		return ioc_.stopped();
 	}
 
 	void executor::shutdown()noexcept{
-		std::call_once(shutdown_flag_, shutdown_fn_);
+		std::call_once(shutdown_flag_, [this]{
+				{
+					std::lock_guard< std::mutex > lock(mutex_);
+					is_shutdown_ = true;
+				}
+
+				stop_probe();
+				shutdown_fn_();
+
+				// Let the threads return after their sessions are closed
+				for(auto& work: thread_works_){
+					work.reset();
+				}
+
+				run_lock_.unlock();
+			});
+	}
+
+	void executor::on_last_lock()noexcept{
+		std::lock_guard< std::mutex > lock(locks_mutex_);
+		locks_released_ = true;
+		locks_cv_.notify_all();
+	}
+
+
+	void executor::start_probe()noexcept try{
+		if(probe_started_.exchange(true, std::memory_order_relaxed)){
+			return;
+		}
+
+		boost::asio::dispatch(probe_strand_,
+			[this, lock = locker_.make_lock()]{ do_probe(); });
+	}catch(...){
+		error_handler_->on_exception(std::current_exception());
+	}
+
+	void executor::do_probe(){
+		if(probe_stopped_){
+			return;
+		}
+
+		probe_timer_.expires_after(probe_interval);
+		probe_timer_.async_wait(bind_recycling(
+			probe_strand_,
+			[this, lock = locker_.make_lock()](boost::system::error_code ec){
+				if(ec == boost::asio::error::operation_aborted){
+					return;
+				}
+
+				auto const posted = std::chrono::steady_clock::now();
+				boost::asio::post(ioc_,
+					[this, lock = locker_.make_lock(), posted]{
+						using std::chrono::duration_cast;
+						auto const delay =
+							duration_cast< std::chrono::microseconds >(
+								std::chrono::steady_clock::now() - posted);
+						record_lag(delay);
+
+						auto const lag =
+							duration_cast< std::chrono::milliseconds >(delay);
+						admission_.set_executor_lag(lag);
+						adapt_thread_count(lag);
+
+						boost::asio::dispatch(probe_strand_,
+							[this, lock = locker_.make_lock()]{ do_probe(); });
+					});
+			}));
+	}
+
+	void executor::record_lag(std::chrono::microseconds const lag)noexcept{
+		// Probes are serialized, so load and store are enough
+		auto& bucket = lag_histogram_[executor_stats::lag_bucket(lag)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		probes_.store(probes_.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		last_lag_.store(lag.count(), std::memory_order_relaxed);
+		if(lag.count() > max_lag_.load(std::memory_order_relaxed)){
+			max_lag_.store(lag.count(), std::memory_order_relaxed);
+		}
+	}
+
+	executor_stats executor::stats(){
+		executor_stats result;
+		for(std::size_t i = 0; i < executor_stats::bucket_count; ++i){
+			result.lag_histogram[i] =
+				lag_histogram_[i].load(std::memory_order_relaxed);
+		}
+		result.probes = probes_.load(std::memory_order_relaxed);
+		result.last_lag = std::chrono::microseconds(
+			last_lag_.load(std::memory_order_relaxed));
+		result.max_lag = std::chrono::microseconds(
+			max_lag_.load(std::memory_order_relaxed));
+
+		std::lock_guard< std::mutex > lock(stats_mutex_);
+		result.threads.reserve(thread_counters_.size());
+		for(auto const counters: thread_counters_){
+			result.threads.push_back(executor_thread_stats{
+					counters->index,
+					counters->handlers.load(std::memory_order_relaxed),
+					std::chrono::nanoseconds(
+						counters->busy.load(std::memory_order_relaxed)),
+					std::chrono::nanoseconds(
+						counters->idle.load(std::memory_order_relaxed))
+				});
+		}
+
+		return result;
+	}
+
+	void executor::stop_probe()noexcept{
+		probe_stopped_ = true;
+
+		try{
+			boost::asio::dispatch(probe_strand_,
+				[this, lock = locker_.make_lock()]{
+					probe_timer_.cancel();
+				});
+		}catch(...){
+			error_handler_->on_exception(std::current_exception());
+		}
 	}
 
 
@@ -67,5 +575,118 @@ namespace webservice{
 		return ioc_;
 	}
 
+	boost::asio::io_context& executor::session_io_context()noexcept{
+		auto const count = session_contexts_.size();
+		if(count < 2){
+			return ioc_;
+		}
+
+		std::size_t index = 0;
+		if(options_.placement == session_placement::round_robin){
+			index = next_context_.fetch_add(1, std::memory_order_relaxed)
+				% count;
+		}else{
+			// Sessions may open and close meanwhile, the result is a hint
+			auto min = session_counts_[0].load(std::memory_order_relaxed);
+			for(std::size_t i = 1; i < count; ++i){
+				auto const sessions =
+					session_counts_[i].load(std::memory_order_relaxed);
+				if(sessions < min){
+					min = sessions;
+					index = i;
+				}
+			}
+		}
+
+		return *session_contexts_[index];
+	}
+
+	boost::asio::io_context& executor::ws_io_context()noexcept{
+		return ws_context_ ? *ws_context_ : session_io_context();
+	}
+
+	boost::asio::io_context* executor::blocking_io_context()noexcept{
+		return blocking_context_;
+	}
+
+	boost::asio::ip::tcp::socket executor::to_ws_context(
+		boost::asio::ip::tcp::socket&& socket
+	){
+		if(!ws_context_){
+			return std::move(socket);
+		}
+
+		return move_socket(std::move(socket), *ws_context_);
+	}
+
+	boost::asio::ip::tcp::socket executor::move_socket(
+		boost::asio::ip::tcp::socket&& socket,
+		boost::asio::io_context& ioc
+	){
+#if BOOST_VERSION >= 107000
+		if(
+			&socket.get_executor().context() !=
+			static_cast< boost::asio::execution_context* >(&ioc)
+		){
+			// A socket that failed already stays where it is, its session
+			// gets the error by the next operation
+			boost::system::error_code ec;
+			auto const protocol = socket.local_endpoint(ec).protocol();
+			if(ec){
+				return std::move(socket);
+			}
+
+			auto const handle = socket.release(ec);
+			if(ec){
+				return std::move(socket);
+			}
+
+			return boost::asio::ip::tcp::socket(ioc, protocol, handle);
+		}
+#else
+		(void)ioc;
+#endif
+		return std::move(socket);
+	}
+
+	boost::asio::io_context& executor::io_context_of(
+		boost::asio::ip::tcp::socket& socket
+	)noexcept{
+		return static_cast< boost::asio::io_context& >(
+			socket.get_executor().context());
+	}
+
+	void executor::session_opened(
+		boost::asio::execution_context& context
+	)noexcept{
+		auto const index = context_index(context);
+		if(index < session_contexts_.size()){
+			session_counts_[index].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void executor::session_closed(
+		boost::asio::execution_context& context
+	)noexcept{
+		auto const index = context_index(context);
+		if(index < session_contexts_.size()){
+			session_counts_[index].fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	std::size_t executor::context_index(
+		boost::asio::execution_context& context
+	)const noexcept{
+		std::size_t index = 0;
+		while(
+			index < session_contexts_.size() &&
+			static_cast< boost::asio::execution_context* >(
+				session_contexts_[index]) != &context
+		){
+			++index;
+		}
+		return index;
+	}
+
 
 }
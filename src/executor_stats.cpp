@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/executor_stats.hpp>
+
+
+namespace webservice{
+
+
+	constexpr std::size_t executor_stats::bucket_count;
+
+
+	std::chrono::microseconds executor_stats::lag_quantile(
+		double const q
+	)const noexcept{
+		if(probes == 0){
+			return std::chrono::microseconds(0);
+		}
+
+		auto const target = q <= 0 ? 1 : static_cast< std::uint64_t >(
+			q * static_cast< double >(probes) + 0.5);
+
+		std::uint64_t sum = 0;
+		std::size_t i = 0;
+		for(; i < bucket_count - 1; ++i){
+			sum += lag_histogram[i];
+			if(sum >= target){
+				break;
+			}
+		}
+
+		if(i == bucket_count - 1){
+			return max_lag;
+		}
+
+		return std::chrono::microseconds(std::int64_t(2) << i);
+	}
+
+	std::size_t executor_stats::lag_bucket(
+		std::chrono::microseconds const lag
+	)noexcept{
+		std::size_t bucket = 0;
+		for(auto value = lag.count(); value > 1; value >>= 1){
+			++bucket;
+		}
+		return bucket < bucket_count ? bucket : bucket_count - 1;
+	}
+
+
+}
@@ -9,6 +9,9 @@
 #include <webservice/file_request_handler.hpp>
 #include <webservice/path_concat.hpp>
 #include <webservice/mime_type.hpp>
+#include <webservice/executor.hpp>
+
+#include <boost/asio/post.hpp>
 
 #include <iostream>
 
@@ -32,6 +35,32 @@ namespace webservice{
 			return;
 		}
 
+		// Opening a file may block, move it to the blocking threads
+		if(auto const blocking = executor().blocking_io_context()){
+			boost::asio::post(*blocking,
+				[
+					this,
+					req = std::move(req),
+					send = std::move(send)
+				]()mutable{
+					try{
+						open_and_send(std::move(req), std::move(send));
+					}catch(...){
+						on_exception(std::current_exception());
+					}
+				});
+			return;
+		}
+
+		open_and_send(std::move(req), std::move(send));
+	}
+
+	void file_request_handler::open_and_send(
+		http_request&& req,
+		http_response&& send
+	){
+		namespace http = boost::beast::http;
+
 		std::string path = with_path(req.target());
 
 		// Attempt to open the file
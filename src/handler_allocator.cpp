@@ -0,0 +1,300 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/handler_allocator.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+namespace webservice{
+
+
+	namespace{
+
+
+		/// \brief Smallest size class is 2^min_class_bits bytes
+		constexpr std::size_t min_class_bits = 6;
+
+		/// \brief Count of size classes, the largest is 1 MiB
+		constexpr std::size_t class_count = 15;
+
+		/// \brief Size class index of unpooled memory
+		constexpr std::size_t no_class = class_count;
+
+		/// \brief Max count of free blocks per size class and thread
+		constexpr std::size_t max_free_blocks = 64;
+
+
+		/// \brief Count of bytes in size class, including the block_header
+		constexpr std::size_t class_capacity(std::size_t size_class)noexcept{
+			return std::size_t(1) << (size_class + min_class_bits);
+		}
+
+		/// \brief Max count of free blocks in size class, less for big
+		///        blocks
+		constexpr std::size_t class_free_blocks(std::size_t size_class)
+			noexcept
+		{
+			return class_capacity(size_class) <= 4096
+				? max_free_blocks : max_free_blocks / 2;
+		}
+
+		/// \brief Smallest size class with at least size bytes, or no_class
+		std::size_t size_class_of(std::size_t size)noexcept{
+			std::size_t size_class = 0;
+			while(
+				size_class < class_count &&
+				class_capacity(size_class) < size
+			){
+				++size_class;
+			}
+			return size_class;
+		}
+
+
+		class block_pool;
+
+		/// \brief Stored in front of every pooled block
+		struct block_header{
+			/// \brief Pool of the allocating thread, nullptr if unpooled
+			block_pool* owner;
+
+			/// \brief Size class of the block
+			std::size_t size_class;
+		};
+
+		/// \brief Distance from a block to the memory of the user
+		constexpr std::size_t header_size =
+			(sizeof(block_header) + alignof(std::max_align_t) - 1) /
+			alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		/// \brief A block that another thread returned to its owner
+		struct remote_block{
+			block_header header;
+
+			remote_block* next;
+		};
+
+
+		/// \brief Free blocks of one thread
+		///
+		/// Only the owning thread uses the free lists. Other threads return
+		/// blocks by push_remote(), the owner takes them over when a free
+		/// list is empty. A pool is never destroyed, when its thread exits
+		/// it is adopted by the next new thread.
+		class block_pool{
+		public:
+			block_pool() = default;
+
+			block_pool(block_pool const&) = delete;
+
+			block_pool& operator=(block_pool const&) = delete;
+
+
+			/// \brief A free block of size_class or nullptr
+			block_header* pop(std::size_t size_class)noexcept{
+				auto& count = counts_[size_class];
+				if(count == 0){
+					take_remote();
+				}
+				return count > 0 ? blocks_[size_class][--count] : nullptr;
+			}
+
+			/// \brief Keep block for reuse, false if the list is full
+			bool push(block_header* block)noexcept{
+				auto const size_class = block->size_class;
+				auto& count = counts_[size_class];
+				if(count == class_free_blocks(size_class)){
+					return false;
+				}
+				blocks_[size_class][count++] = block;
+				return true;
+			}
+
+			/// \brief Return block from another thread
+			void push_remote(block_header* block)noexcept{
+				auto const node = reinterpret_cast< remote_block* >(block);
+				node->next = remote_.load(std::memory_order_relaxed);
+				while(!remote_.compare_exchange_weak(node->next, node,
+					std::memory_order_release, std::memory_order_relaxed)){}
+			}
+
+			/// \brief Free the blocks of the free lists
+			void release()noexcept{
+				for(std::size_t i = 0; i < class_count; ++i){
+					for(std::size_t j = 0; j < counts_[i]; ++j){
+						::operator delete(blocks_[i][j]);
+					}
+					counts_[i] = 0;
+				}
+			}
+
+
+		private:
+			/// \brief Move the blocks returned by other threads to the lists
+			void take_remote()noexcept{
+				if(remote_.load(std::memory_order_relaxed) == nullptr){
+					return;
+				}
+
+				auto node = remote_.exchange(nullptr,
+					std::memory_order_acquire);
+				while(node != nullptr){
+					auto const next = node->next;
+					if(!push(&node->header)){
+						::operator delete(node);
+					}
+					node = next;
+				}
+			}
+
+
+			/// \brief Free blocks per size class
+			std::array< std::array< block_header*, max_free_blocks >,
+				class_count > blocks_;
+
+			/// \brief Count of free blocks per size class
+			std::array< std::size_t, class_count > counts_{};
+
+			/// \brief Blocks returned by other threads
+			std::atomic< remote_block* > remote_{nullptr};
+		};
+
+
+		/// \brief Pools of exited threads
+		class abandoned_pools{
+		public:
+			/// \brief The process wide list, never destroyed
+			static abandoned_pools& get(){
+				static auto const pools = new abandoned_pools;
+				return *pools;
+			}
+
+			/// \brief A pool of an exited thread or a new pool
+			block_pool* adopt(){
+				{
+					std::lock_guard< std::mutex > lock(mutex_);
+					if(!pools_.empty()){
+						auto const pool = pools_.back();
+						pools_.pop_back();
+						return pool;
+					}
+				}
+				return new block_pool;
+			}
+
+			/// \brief Keep pool for the next thread
+			void abandon(block_pool* pool)noexcept{
+				pool->release();
+				try{
+					std::lock_guard< std::mutex > lock(mutex_);
+					pools_.push_back(pool);
+				}catch(...){
+					// The pool leaks, blocks of it may still be returned
+				}
+			}
+
+
+		private:
+			std::mutex mutex_;
+
+			std::vector< block_pool* > pools_;
+		};
+
+
+		/// \brief Pool of this thread, nullptr if there is none (yet)
+		thread_local block_pool* current_pool = nullptr;
+
+		/// \brief Set when the pool of this thread was abandoned
+		///
+		/// Memory allocated after that, e.g. by other thread_local objects,
+		/// is not pooled.
+		thread_local bool pool_abandoned = false;
+
+
+		/// \brief Owns the pool of this thread until the thread exits
+		class thread_pool{
+		public:
+			thread_pool(){
+				current_pool = abandoned_pools::get().adopt();
+			}
+
+			thread_pool(thread_pool const&) = delete;
+
+			~thread_pool(){
+				pool_abandoned = true;
+				abandoned_pools::get().abandon(
+					std::exchange(current_pool, nullptr));
+			}
+
+			thread_pool& operator=(thread_pool const&) = delete;
+		};
+
+
+		/// \brief Pool of this thread, created on first use, nullptr after
+		///        it was abandoned
+		block_pool* local_pool(){
+			if(current_pool == nullptr && !pool_abandoned){
+				static thread_local thread_pool pool;
+			}
+			return current_pool;
+		}
+
+
+	}
+
+
+	void* detail::handler_allocate(std::size_t size){
+		auto const size_class = size_class_of(size + header_size);
+		if(size_class == no_class){
+			return ::operator new(size);
+		}
+
+		auto const pool = local_pool();
+		auto block = pool ? pool->pop(size_class) : nullptr;
+		if(block == nullptr){
+			block = static_cast< block_header* >(
+				::operator new(class_capacity(size_class)));
+			block->size_class = size_class;
+		}
+		block->owner = pool;
+
+		return reinterpret_cast< unsigned char* >(block) + header_size;
+	}
+
+	void detail::handler_deallocate(void* pointer, std::size_t size)noexcept{
+		if(size_class_of(size + header_size) == no_class){
+			::operator delete(pointer);
+			return;
+		}
+
+		auto const block = reinterpret_cast< block_header* >(
+			static_cast< unsigned char* >(pointer) - header_size);
+		auto const owner = block->owner;
+		if(owner == nullptr){
+			::operator delete(block);
+		}else if(owner != current_pool){
+			owner->push_remote(block);
+		}else if(!owner->push(block)){
+			::operator delete(block);
+		}
+	}
+
+	std::size_t detail::handler_block_size(std::size_t size)noexcept{
+		auto const size_class = size_class_of(size + header_size);
+		return size_class == no_class
+			? size : class_capacity(size_class) - header_size;
+	}
+
+
+}
@@ -104,6 +104,21 @@ namespace webservice{
 		return res;
 	}
 
+	http_string_response service_unavailable(
+		http_request const& req,
+		std::chrono::seconds retry_after
+	){
+		http_string_response res{
+			http::status::service_unavailable, req.version()};
+		res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+		res.set(http::field::content_type, "text/html");
+		res.set(http::field::retry_after, std::to_string(retry_after.count()));
+		res.keep_alive(false);
+		res.body() = "The service is temporarily unavailable.";
+		res.prepare_payload();
+		return res;
+	}
+
 
 	void http_request_handler::set_server(server_impl& server){
 		list_ = std::make_unique< http_sessions >(server);
@@ -117,5 +132,13 @@ namespace webservice{
 		return list_->server();
 	}
 
+	class executor& http_request_handler::executor(){
+		if(!list_){
+			throw std::logic_error("called executor() before set_server");
+		}
+
+		return list_->executor();
+	}
+
 
 }
@@ -10,12 +10,13 @@
 #include "server_impl.hpp"
 
 #include <webservice/server.hpp>
+#include <webservice/executor.hpp>
 #include <webservice/async_locker.hpp>
+#include <webservice/http_request_handler.hpp>
+#include <webservice/handler_allocator.hpp>
 
 #include <boost/beast/websocket.hpp>
 
-#include <boost/asio/bind_executor.hpp>
-
 
 namespace webservice{
 
@@ -26,18 +27,24 @@ namespace webservice{
 	)
 		: server_(server)
 		, socket_(std::move(socket))
-		, strand_(socket_.get_executor())
-		, timer_(socket_.get_executor().context(),
+		, strand_(executor::io_context_of(socket_).get_executor())
+		, timer_(executor::io_context_of(socket_),
 			std::chrono::steady_clock::time_point::max())
 		, locker_([this]()noexcept{
 				server_.http().async_erase(this);
 			})
-		{}
+	{
+		server_.executor().session_opened(socket_.get_executor().context());
+	}
+
+	http_session::~http_session(){
+		server_.executor().session_closed(socket_.get_executor().context());
+	}
 
 
 	// Called when the timer expires.
 	void http_session::do_timer(){
-		timer_.async_wait(boost::asio::bind_executor(
+		timer_.async_wait(bind_recycling(
 			strand_,
 			[this, lock = locker_.make_lock()](
 				boost::system::error_code ec
@@ -88,7 +95,7 @@ namespace webservice{
 
 		// Read a request
 		boost::beast::http::async_read(socket_, buffer_, req_,
-			boost::asio::bind_executor(
+			bind_recycling(
 				strand_,
 				[this, lock = locker_.make_lock()](
 					boost::system::error_code ec,
@@ -99,9 +106,14 @@ namespace webservice{
 						return;
 					}
 
-					// This means endpoint closed the session
+					// This means endpoint closed the session, outstanding
+					// responses are still sent
 					if(ec == boost::beast::http::error::end_of_stream){
-						do_close();
+						if(queue_.is_empty()){
+							do_close();
+						}else{
+							close_after_responses_ = true;
+						}
 						return;
 					}
 
@@ -118,9 +130,26 @@ namespace webservice{
 						server_.has_ws() &&
 						boost::beast::websocket::is_upgrade(req_)
 					){
-						server_.ws().server_connect(
-							std::move(socket_), std::move(req_));
-						do_close();
+						auto& admission = server_.executor().admission();
+						if(auto ticket = admission.admit()){
+							server_.ws().server_connect(
+								server_.executor().to_ws_context(
+									std::move(socket_)),
+								std::move(req_), std::move(ticket));
+							do_close();
+						}else{
+							// Reject before any WebSocket session exists,
+							// the response closes the connection
+							http_response{
+								this,
+								locker_,
+								&http_session::response,
+								socket_,
+								strand_,
+								queue_.reserve()
+							}(service_unavailable(req_,
+								admission.retry_after()));
+						}
 					}else{
 						// Send the response
 						server_.http()(std::move(req_),
@@ -129,15 +158,15 @@ namespace webservice{
 								locker_,
 								&http_session::response,
 								socket_,
-								strand_
+								strand_,
+								queue_.reserve()
 							});
 
 						// If we aren't at the queue limit, try to pipeline
-						// another request
+						// another request, otherwise on_write() reads on
+						// when a response was sent
 						if(!queue_.is_full()){
 							do_read();
-						}else{
-							do_close();
 						}
 					}
 				}));
@@ -174,7 +203,12 @@ namespace webservice{
 		}
 
 		// Inform the queue that a write completed
-		if(queue_.on_write()){
+		auto const read = queue_.on_write();
+		if(close_after_responses_){
+			if(queue_.is_empty()){
+				do_close();
+			}
+		}else if(read){
 			// Read another request
 			do_read();
 		}
@@ -190,9 +224,14 @@ namespace webservice{
 
 	/// \brief Called by the HTTP handler to send a response.
 	void http_session::response(
+		std::size_t const slot,
 		std::unique_ptr< http_session_work >&& work
 	){
-		queue_.response(std::move(work));
+		queue_.response(slot, std::move(work));
+	}
+
+	void http_session::on_exception(std::exception_ptr error)noexcept{
+		server_.http().on_exception(error);
 	}
 
 
@@ -203,25 +242,61 @@ namespace webservice{
 		return items_.size() >= limit;
 	}
 
+	bool http_session::queue::is_empty()const{
+		return items_.empty();
+	}
+
+	std::size_t http_session::queue::reserve(){
+		items_.push_back(nullptr);
+		return first_slot_ + items_.size() - 1;
+	}
+
 	bool http_session::queue::on_write(){
 		BOOST_ASSERT(!items_.empty());
 		auto const was_full = is_full();
 		items_.pop_front();
-		if(!items_.empty()){
+		++first_slot_;
+
+		// Start the next response if it was already sent
+		if(!items_.empty() && items_.front()){
 			(*items_.front())();
 		}
 		return was_full;
 	}
 
 	void http_session::queue::response(
+		std::size_t const slot,
 		std::unique_ptr< http_session_work >&& work
 	){
-		// Allocate and store the work
-		items_.push_back(std::move(work));
+		BOOST_ASSERT(slot - first_slot_ < items_.size());
+		auto& item = items_[slot - first_slot_];
+		item = std::move(work);
 
-		// If there was no previous work, start this one
-		if(items_.size() == 1){
-			(*items_.front())();
+		// Earlier responses are still outstanding otherwise
+		if(slot == first_slot_){
+			(*item)();
+		}
+	}
+
+
+	http_response::~http_response(){
+		// The handler dropped the response, answer its slot so that the
+		// later pipelined responses are not stalled
+		if(!lock_.is_locked()){
+			return;
+		}
+
+		try{
+			namespace http = boost::beast::http;
+			http_string_response res{http::status::internal_server_error, 11};
+			res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+			res.set(http::field::content_type, "text/html");
+			res.keep_alive(false);
+			res.body() = "The request was not answered.";
+			res.prepare_payload();
+			(*this)(std::move(res));
+		}catch(...){
+			self_->on_exception(std::current_exception());
 		}
 	}
 
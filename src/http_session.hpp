@@ -20,6 +20,8 @@
 #include <boost/asio/strand.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include <exception>
+
 
 namespace webservice{
 
@@ -40,6 +42,9 @@ namespace webservice{
 			class server_impl& server
 		);
 
+		/// \brief Uncount the session in the executor
+		~http_session();
+
 		/// \brief Start timer and read
 		void run();
 
@@ -47,11 +52,18 @@ namespace webservice{
 		void do_close();
 
 		/// \brief Called by the HTTP handler to send a response.
-		void response(std::unique_ptr< http_session_work >&& work);
+		void response(
+			std::size_t slot,
+			std::unique_ptr< http_session_work >&& work);
 
 		/// \brief Called when data was received
 		void on_write(boost::system::error_code ec, bool close);
 
+		/// \brief Report an error to the HTTP request handler
+		///
+		/// Thread safe: Yes.
+		void on_exception(std::exception_ptr error)noexcept;
+
 
 	private:
 		/// \brief Async wait on timer
@@ -76,19 +88,32 @@ namespace webservice{
 			/// \brief Returns true if we have reached the queue limit
 			bool is_full()const;
 
+			/// \brief Returns true if no response is outstanding
+			bool is_empty()const;
+
+			/// \brief Reserve the place of the next response
+			///
+			/// Returns the slot for response().
+			std::size_t reserve();
+
 			/// \brief Called when a message finishes sending
 			///
 			/// Returns true if the caller should initiate a read
 			bool on_write();
 
 			/// \brief Called by the HTTP handler to send a response.
-			void response(std::unique_ptr< http_session_work >&& work);
+			void response(
+				std::size_t slot,
+				std::unique_ptr< http_session_work >&& work);
 
 
 		private:
-			/// \brief
+			/// \brief Responses in request order, empty until sent
 			boost::circular_buffer< std::unique_ptr< http_session_work > >
 				items_;
+
+			/// \brief Slot of the first element in items_
+			std::size_t first_slot_{0};
 		};
 
 
@@ -102,6 +127,10 @@ namespace webservice{
 		http_request req_;
 		queue queue_;
 
+		/// \brief The peer closed its side, close after the outstanding
+		///        responses
+		bool close_after_responses_{false};
+
 		async_locker locker_;
 	};
 
@@ -10,12 +10,16 @@
 #include "http_session.hpp"
 #include "server_impl.hpp"
 
+#include <webservice/handler_allocator.hpp>
+
 
 namespace webservice{
 
 
 	http_sessions::http_sessions(server_impl& server)
 		: server_(server)
+		, executor_lock_(server_.executor().make_lock())
+		, locker_([this]()noexcept{ executor_lock_.unlock(); })
 		, run_lock_(locker_.make_first_lock())
 		, strand_(server_.executor().get_executor()) {}
 
@@ -24,6 +28,10 @@ namespace webservice{
 		return server_.server();
 	}
 
+	class executor& http_sessions::executor()const noexcept{
+		return server_.executor();
+	}
+
 
 	void http_sessions::async_emplace(
 		boost::asio::ip::tcp::socket&& socket
@@ -50,7 +58,7 @@ namespace webservice{
 					async_erase(session.get());
 					throw;
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		server_.http().on_exception(std::current_exception());
 	}
@@ -67,7 +75,7 @@ namespace webservice{
 				if(set_.empty() && is_shutdown()){
 					shutdown_lock_.unlock();
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		server_.http().on_exception(std::current_exception());
 	}
@@ -90,7 +98,7 @@ namespace webservice{
 							session->do_close();
 						}
 					}
-				}, std::allocator< void >());
+				}, recycling_allocator< void >());
 		}
 	}
 
@@ -13,6 +13,7 @@
 
 #include <boost/beast/websocket.hpp>
 
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 
 #include <set>
@@ -77,6 +78,8 @@ namespace webservice{
 
 		class server& server()const noexcept;
 
+		class executor& executor()const noexcept;
+
 
 		void async_emplace(boost::asio::ip::tcp::socket&& socket)noexcept;
 
@@ -91,6 +94,7 @@ namespace webservice{
 
 	private:
 		class server_impl& server_;
+		async_locker::lock executor_lock_;
 		async_locker locker_;
 		async_locker::lock run_lock_;
 		async_locker::lock shutdown_lock_;
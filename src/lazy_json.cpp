@@ -0,0 +1,643 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/lazy_json.hpp>
+
+#include <cctype>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+
+namespace webservice{
+
+
+	namespace{
+
+
+		/// \brief Max nesting depth of arrays and objects
+		constexpr std::size_t max_depth = 512;
+
+
+		/// \brief Name of type for error messages
+		char const* type_name(lazy_json_type type)noexcept{
+			switch(type){
+				case lazy_json_type::null: return "null";
+				case lazy_json_type::boolean: return "boolean";
+				case lazy_json_type::number: return "number";
+				case lazy_json_type::string: return "string";
+				case lazy_json_type::array: return "array";
+				case lazy_json_type::object: return "object";
+			}
+			return "unknown";
+		}
+
+
+		/// \brief Validates JSON text and records all values
+		class scanner{
+		public:
+			scanner(
+				char const* data,
+				std::size_t size,
+				std::vector< detail::lazy_json_token >& tokens
+			)noexcept
+				: data_(data)
+				, size_(size)
+				, tokens_(tokens) {}
+
+			void run(){
+				value(0);
+				skip_whitespace();
+				if(pos_ != size_){
+					fail("unexpected character after the top level value");
+				}
+			}
+
+
+		private:
+			[[noreturn]] void fail(char const* what)const{
+				throw std::runtime_error("invalid JSON at byte "
+					+ std::to_string(pos_) + ": " + what);
+			}
+
+			void skip_whitespace()noexcept{
+				while(pos_ < size_){
+					auto const c = data_[pos_];
+					if(c != ' ' && c != '\n' && c != '\r' && c != '\t'){
+						return;
+					}
+					++pos_;
+				}
+			}
+
+			/// \brief Skip whitespace and return the next character
+			char peek(){
+				skip_whitespace();
+				if(pos_ == size_){
+					fail("unexpected end of input");
+				}
+				return data_[pos_];
+			}
+
+			/// \brief Add a token starting at the current position
+			std::size_t add(lazy_json_type type){
+				auto const index = tokens_.size();
+				tokens_.push_back({static_cast< std::uint32_t >(pos_), 0,
+					static_cast< std::uint32_t >(index + 1), 0, type, false});
+				return index;
+			}
+
+			/// \brief Set the end of a token to the current position
+			void finish(std::size_t index)noexcept{
+				auto& token = tokens_[index];
+				token.end = static_cast< std::uint32_t >(pos_);
+				token.next = static_cast< std::uint32_t >(tokens_.size());
+			}
+
+
+			void value(std::size_t depth){
+				switch(peek()){
+					case '{': object(depth); break;
+					case '[': array(depth); break;
+					case '"': string(); break;
+					case 't': literal("true", lazy_json_type::boolean); break;
+					case 'f': literal("false", lazy_json_type::boolean); break;
+					case 'n': literal("null", lazy_json_type::null); break;
+					default: number();
+				}
+			}
+
+			void object(std::size_t depth){
+				if(depth == max_depth){
+					fail("nesting too deep");
+				}
+
+				auto const index = add(lazy_json_type::object);
+				++pos_;
+
+				std::uint32_t count = 0;
+				if(peek() == '}'){
+					++pos_;
+				}else{
+					for(;;){
+						if(peek() != '"'){
+							fail("expected object key");
+						}
+						string();
+						if(peek() != ':'){
+							fail("expected ':'");
+						}
+						++pos_;
+						value(depth + 1);
+						++count;
+
+						auto const c = peek();
+						++pos_;
+						if(c == '}'){
+							break;
+						}
+						if(c != ','){
+							--pos_;
+							fail("expected ',' or '}'");
+						}
+					}
+				}
+
+				finish(index);
+				tokens_[index].count = count;
+			}
+
+			void array(std::size_t depth){
+				if(depth == max_depth){
+					fail("nesting too deep");
+				}
+
+				auto const index = add(lazy_json_type::array);
+				++pos_;
+
+				std::uint32_t count = 0;
+				if(peek() == ']'){
+					++pos_;
+				}else{
+					for(;;){
+						value(depth + 1);
+						++count;
+
+						auto const c = peek();
+						++pos_;
+						if(c == ']'){
+							break;
+						}
+						if(c != ','){
+							--pos_;
+							fail("expected ',' or ']'");
+						}
+					}
+				}
+
+				finish(index);
+				tokens_[index].count = count;
+			}
+
+			void string(){
+				auto const index = add(lazy_json_type::string);
+				++pos_;
+
+				bool escaped = false;
+				for(;;){
+					if(pos_ == size_){
+						fail("unterminated string");
+					}
+
+					auto const c = static_cast< unsigned char >(data_[pos_]);
+					if(c == '"'){
+						break;
+					}else if(c == '\\'){
+						escaped = true;
+						++pos_;
+						if(pos_ == size_){
+							fail("unterminated string");
+						}
+						switch(data_[pos_]){
+							case '"': case '\\': case '/': case 'b':
+							case 'f': case 'n': case 'r': case 't':
+							break;
+							case 'u':
+								for(std::size_t i = 0; i < 4; ++i){
+									++pos_;
+									if(pos_ == size_ ||
+										!std::isxdigit(static_cast<
+											unsigned char >(data_[pos_]))
+									){
+										fail("invalid \\u escape sequence");
+									}
+								}
+							break;
+							default:
+								fail("invalid escape sequence");
+						}
+					}else if(c < 0x20){
+						fail("control character in string");
+					}
+					++pos_;
+				}
+				++pos_;
+
+				finish(index);
+				tokens_[index].escaped = escaped;
+			}
+
+			void literal(char const* text, lazy_json_type type){
+				auto const index = add(type);
+				auto const length = std::strlen(text);
+				if(
+					size_ - pos_ < length ||
+					std::memcmp(data_ + pos_, text, length) != 0
+				){
+					fail("invalid literal");
+				}
+				pos_ += length;
+				finish(index);
+			}
+
+			bool digit()const noexcept{
+				return pos_ < size_ && data_[pos_] >= '0' && data_[pos_] <= '9';
+			}
+
+			void digits(){
+				if(!digit()){
+					fail("expected digit");
+				}
+				do{
+					++pos_;
+				}while(digit());
+			}
+
+			void number(){
+				auto const index = add(lazy_json_type::number);
+				if(data_[pos_] == '-'){
+					++pos_;
+				}
+
+				if(pos_ < size_ && data_[pos_] == '0'){
+					++pos_;
+				}else if(digit()){
+					digits();
+				}else{
+					fail("unexpected character");
+				}
+
+				if(pos_ < size_ && data_[pos_] == '.'){
+					++pos_;
+					digits();
+				}
+
+				if(pos_ < size_ && (data_[pos_] == 'e' || data_[pos_] == 'E')){
+					++pos_;
+					if(pos_ < size_ &&
+						(data_[pos_] == '+' || data_[pos_] == '-')){
+						++pos_;
+					}
+					digits();
+				}
+
+				finish(index);
+			}
+
+
+			char const* const data_;
+			std::size_t const size_;
+			std::size_t pos_{0};
+			std::vector< detail::lazy_json_token >& tokens_;
+		};
+
+
+		void append_utf8(std::string& result, std::uint32_t code_point){
+			if(code_point < 0x80){
+				result.push_back(static_cast< char >(code_point));
+			}else if(code_point < 0x800){
+				result.push_back(static_cast< char >(0xC0 | (code_point >> 6)));
+				result.push_back(static_cast< char >(
+					0x80 | (code_point & 0x3F)));
+			}else if(code_point < 0x10000){
+				result.push_back(static_cast< char >(
+					0xE0 | (code_point >> 12)));
+				result.push_back(static_cast< char >(
+					0x80 | ((code_point >> 6) & 0x3F)));
+				result.push_back(static_cast< char >(
+					0x80 | (code_point & 0x3F)));
+			}else{
+				result.push_back(static_cast< char >(
+					0xF0 | (code_point >> 18)));
+				result.push_back(static_cast< char >(
+					0x80 | ((code_point >> 12) & 0x3F)));
+				result.push_back(static_cast< char >(
+					0x80 | ((code_point >> 6) & 0x3F)));
+				result.push_back(static_cast< char >(
+					0x80 | (code_point & 0x3F)));
+			}
+		}
+
+		std::uint32_t parse_hex4(char const* data)noexcept{
+			std::uint32_t result = 0;
+			for(std::size_t i = 0; i < 4; ++i){
+				auto const c = data[i];
+				result = result * 16 + static_cast< std::uint32_t >(
+					c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+			}
+			return result;
+		}
+
+		/// \brief Unescape the content of a validated string
+		std::string unescape(char const* first, char const* last){
+			std::string result;
+			result.reserve(static_cast< std::size_t >(last - first));
+			while(first != last){
+				if(*first != '\\'){
+					result.push_back(*first++);
+					continue;
+				}
+
+				++first;
+				switch(*first++){
+					case '"': result.push_back('"'); break;
+					case '\\': result.push_back('\\'); break;
+					case '/': result.push_back('/'); break;
+					case 'b': result.push_back('\b'); break;
+					case 'f': result.push_back('\f'); break;
+					case 'n': result.push_back('\n'); break;
+					case 'r': result.push_back('\r'); break;
+					case 't': result.push_back('\t'); break;
+					default:{ // 'u'
+						auto code_point = parse_hex4(first);
+						first += 4;
+						if(code_point >= 0xD800 && code_point < 0xDC00){
+							if(
+								last - first < 6 ||
+								first[0] != '\\' || first[1] != 'u'
+							){
+								throw std::runtime_error(
+									"unpaired UTF-16 surrogate in string");
+							}
+							auto const low = parse_hex4(first + 2);
+							if(low < 0xDC00 || low >= 0xE000){
+								throw std::runtime_error(
+									"unpaired UTF-16 surrogate in string");
+							}
+							first += 6;
+							code_point = 0x10000 +
+								((code_point - 0xD800) << 10) + (low - 0xDC00);
+						}else if(code_point >= 0xDC00 && code_point < 0xE000){
+							throw std::runtime_error(
+								"unpaired UTF-16 surrogate in string");
+						}
+						append_utf8(result, code_point);
+					}
+				}
+			}
+			return result;
+		}
+
+
+		/// \brief Parse an integral number, false on overflow
+		bool parse_unsigned(
+			boost::string_view text,
+			std::uint64_t& result
+		)noexcept{
+			result = 0;
+			for(auto const c: text){
+				if(c < '0' || c > '9'){
+					return false;
+				}
+				auto const digit = static_cast< std::uint64_t >(c - '0');
+				if(result > (std::numeric_limits< std::uint64_t >::max()
+					- digit) / 10){
+					return false;
+				}
+				result = result * 10 + digit;
+			}
+			return true;
+		}
+
+
+	}
+
+
+	lazy_json::lazy_json(boost::beast::multi_buffer&& buffer)
+		: buffer_(std::move(buffer))
+	{
+		auto const buffers = buffer_.data();
+		auto const begin = boost::asio::buffer_sequence_begin(buffers);
+		auto const end = boost::asio::buffer_sequence_end(buffers);
+		if(begin != end && std::next(begin) == end){
+			boost::asio::const_buffer const segment(*begin);
+			data_ = static_cast< char const* >(segment.data());
+			size_ = segment.size();
+		}else{
+			constexpr from_multi_buffer_t< std::string > to_string{};
+			copy_ = to_string(buffer_);
+			buffer_.consume(buffer_.size());
+			data_ = copy_.data();
+			size_ = copy_.size();
+		}
+
+		index();
+	}
+
+	lazy_json::lazy_json(std::string text)
+		: copy_(std::move(text))
+		, data_(copy_.data())
+		, size_(copy_.size())
+	{
+		index();
+	}
+
+	lazy_json::lazy_json(lazy_json&& other)
+		: data_(nullptr)
+		, size_(0)
+	{
+		*this = std::move(other);
+	}
+
+	lazy_json& lazy_json::operator=(lazy_json&& other){
+		auto const in_copy = other.data_ == other.copy_.data();
+		buffer_ = std::move(other.buffer_);
+		copy_ = std::move(other.copy_);
+		data_ = in_copy ? copy_.data() : other.data_;
+		size_ = other.size_;
+		tokens_ = std::move(other.tokens_);
+		return *this;
+	}
+
+	void lazy_json::index(){
+		if(size_ > std::numeric_limits< std::uint32_t >::max()){
+			throw std::runtime_error("JSON message too big for lazy_json");
+		}
+
+		// A typical message has about one value per 8 bytes
+		tokens_.reserve(size_ / 8 + 1);
+		scanner(data_, size_, tokens_).run();
+	}
+
+
+	detail::lazy_json_token const& lazy_json_value::token()const{
+		if(!document_){
+			throw std::out_of_range("access to missing JSON value");
+		}
+		return document_->tokens_[index_];
+	}
+
+	void lazy_json_value::expect(lazy_json_type type)const{
+		auto const actual = token().type;
+		if(actual != type){
+			throw std::runtime_error(std::string("JSON value is ")
+				+ type_name(actual) + " but " + type_name(type)
+				+ " was expected");
+		}
+	}
+
+	lazy_json_type lazy_json_value::type()const{
+		return token().type;
+	}
+
+	boost::string_view lazy_json_value::raw()const{
+		auto const& token = this->token();
+		return boost::string_view(document_->data_ + token.begin,
+			token.end - token.begin);
+	}
+
+	std::size_t lazy_json_value::size()const{
+		auto const& token = this->token();
+		if(
+			token.type != lazy_json_type::array &&
+			token.type != lazy_json_type::object
+		){
+			throw std::runtime_error(std::string("JSON value is ")
+				+ type_name(token.type) + " but array or object was expected");
+		}
+		return token.count;
+	}
+
+	lazy_json_value lazy_json_value::find(boost::string_view key)const noexcept{
+		if(!document_){
+			return {};
+		}
+
+		auto const& tokens = document_->tokens_;
+		auto const& token = tokens[index_];
+		if(token.type != lazy_json_type::object){
+			return {};
+		}
+
+		auto index = index_ + 1;
+		for(std::size_t i = 0; i < token.count; ++i){
+			lazy_json_value const name(document_, index);
+			try{
+				if(name.equals(key)){
+					return lazy_json_value(document_, index + 1);
+				}
+			}catch(...){
+				// key with invalid escape sequence can not match
+			}
+			index = tokens[index + 1].next;
+		}
+
+		return {};
+	}
+
+	lazy_json_value lazy_json_value::at(boost::string_view key)const{
+		expect(lazy_json_type::object);
+		auto const result = find(key);
+		if(!result){
+			throw std::out_of_range("JSON object has no member '"
+				+ key.to_string() + "'");
+		}
+		return result;
+	}
+
+	lazy_json_value lazy_json_value::at(std::size_t index)const{
+		expect(lazy_json_type::array);
+		auto const& tokens = document_->tokens_;
+		if(index >= tokens[index_].count){
+			throw std::out_of_range("JSON array index "
+				+ std::to_string(index) + " out of range");
+		}
+
+		auto element = index_ + 1;
+		for(std::size_t i = 0; i < index; ++i){
+			element = tokens[element].next;
+		}
+		return lazy_json_value(document_, element);
+	}
+
+	bool lazy_json_value::get_bool()const{
+		expect(lazy_json_type::boolean);
+		return document_->data_[token().begin] == 't';
+	}
+
+	std::int64_t lazy_json_value::get_int64()const{
+		expect(lazy_json_type::number);
+		auto text = raw();
+		auto const negative = text.front() == '-';
+		if(negative){
+			text.remove_prefix(1);
+		}
+
+		std::uint64_t magnitude;
+		auto const limit =
+			static_cast< std::uint64_t >(
+				std::numeric_limits< std::int64_t >::max()) +
+			(negative ? 1 : 0);
+		if(!parse_unsigned(text, magnitude) || magnitude > limit){
+			throw std::runtime_error("JSON number " + raw().to_string()
+				+ " is no 64 bit signed integer");
+		}
+
+		return negative
+			? static_cast< std::int64_t >(0 - magnitude)
+			: static_cast< std::int64_t >(magnitude);
+	}
+
+	std::uint64_t lazy_json_value::get_uint64()const{
+		expect(lazy_json_type::number);
+		std::uint64_t result;
+		if(!parse_unsigned(raw(), result)){
+			throw std::runtime_error("JSON number " + raw().to_string()
+				+ " is no 64 bit unsigned integer");
+		}
+		return result;
+	}
+
+	double lazy_json_value::get_double()const{
+		expect(lazy_json_type::number);
+
+		// strtod needs a null terminated string with the decimal point of
+		// the current locale
+		auto text = raw().to_string();
+		auto const decimal_point = *std::localeconv()->decimal_point;
+		if(decimal_point != '.'){
+			auto const pos = text.find('.');
+			if(pos != std::string::npos){
+				text[pos] = decimal_point;
+			}
+		}
+		return std::strtod(text.c_str(), nullptr);
+	}
+
+	std::string lazy_json_value::get_string()const{
+		expect(lazy_json_type::string);
+		auto const& token = this->token();
+		auto const first = document_->data_ + token.begin + 1;
+		auto const last = document_->data_ + token.end - 1;
+		return token.escaped
+			? unescape(first, last)
+			: std::string(first, last);
+	}
+
+	bool lazy_json_value::equals(boost::string_view text)const{
+		if(!document_){
+			return false;
+		}
+
+		auto const& token = this->token();
+		if(token.type != lazy_json_type::string){
+			return false;
+		}
+
+		if(token.escaped){
+			return get_string() == text;
+		}
+
+		return boost::string_view(document_->data_ + token.begin + 1,
+			token.end - token.begin - 2) == text;
+	}
+
+
+}
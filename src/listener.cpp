@@ -11,6 +11,7 @@
 
 #include <webservice/error_handler.hpp>
 #include <webservice/http_request_handler.hpp>
+#include <webservice/handler_allocator.hpp>
 
 
 namespace webservice{
@@ -23,7 +24,6 @@ namespace webservice{
 	)
 		: server_(server)
 		, acceptor_(ioc)
-		, socket_(ioc)
 	{
 		// Open the acceptor
 		acceptor_.open(endpoint.protocol());
@@ -37,33 +37,36 @@ namespace webservice{
 
 		// Start listening for connections
 		acceptor_.listen(boost::asio::socket_base::max_listen_connections);
-
-		// Start accepting incoming connections
-		do_accept();
 	}
 
 
 	void listener::do_accept(){
+		// The socket is created on the io_context of its future session
 		acceptor_.async_accept(
-			socket_,
-			[this](boost::system::error_code ec){
-				if(ec == boost::asio::error::operation_aborted){
-					return;
-				}
-
-				if(ec){
-					server_.error().on_exception(
-						std::make_exception_ptr(boost::system::system_error(
-							ec, "server listener accept")));
-					return;
-				}else{
-					// Create and run the http_session
-					server_.http().async_emplace(std::move(socket_));
-				}
-
-				// Accept another connection
-				do_accept();
-			});
+			server_.executor().session_io_context(),
+			bind_recycling_allocator(
+				[this, lock = server_.executor().make_lock()](
+					boost::system::error_code ec,
+					boost::asio::ip::tcp::socket socket
+				){
+					if(ec == boost::asio::error::operation_aborted){
+						return;
+					}
+
+					if(ec){
+						server_.error().on_exception(
+							std::make_exception_ptr(
+								boost::system::system_error(
+									ec, "server listener accept")));
+						return;
+					}else{
+						// Create and run the http_session
+						server_.http().async_emplace(std::move(socket));
+					}
+
+					// Accept another connection
+					do_accept();
+				}));
 	}
 
 	void listener::shutdown()noexcept{
@@ -19,7 +19,7 @@ namespace webservice{
 	/// \brief Accepts incoming connections and launches the sessions
 	class listener{
 	public:
-		/// \brief Constructor
+		/// \brief Open the acceptor, call do_accept() to start accepting
 		listener(
 			class server_impl& server,
 			boost::asio::ip::tcp::endpoint endpoint,
@@ -42,9 +42,6 @@ namespace webservice{
 
 		/// \brief The acceptor
 		boost::asio::ip::tcp::acceptor acceptor_;
-
-		/// \brief The socket
-		boost::asio::ip::tcp::socket socket_;
 	};
 
 
@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/message_builder.hpp>
+
+#include <new>
+
+
+namespace webservice{
+
+
+	detail::pooled_buffer_holder* detail::pooled_buffer_holder::acquire(
+		std::size_t size
+	){
+		auto const capacity = handler_block_size(
+			pooled_buffer_header_size + size) - pooled_buffer_header_size;
+		return new(handler_allocate(pooled_buffer_header_size + capacity))
+			pooled_buffer_holder(capacity);
+	}
+
+	void detail::pooled_buffer_holder::destroy()noexcept{
+		auto const size = pooled_buffer_header_size + capacity_;
+		void* block = this;
+		this->~pooled_buffer_holder();
+		handler_deallocate(block, size);
+	}
+
+
+	void message_builder::grow(std::size_t capacity){
+		auto storage = detail::pooled_buffer_holder::acquire(capacity);
+		if(storage_){
+			if(size_ > 0){
+				std::memcpy(storage->data(), storage_->data(), size_);
+			}
+			storage_->discard();
+		}
+		storage_ = storage;
+	}
+
+	shared_const_buffer message_builder::freeze(){
+		auto const size = size_;
+		size_ = 0;
+
+		if(size <= shared_const_buffer::copy_capacity){
+			return shared_const_buffer(
+				boost::asio::const_buffer(data(), size));
+		}
+
+		auto const storage = storage_;
+		storage_ = nullptr;
+		return shared_const_buffer(storage,
+			boost::asio::const_buffer(storage->data(), size));
+	}
+
+
+}
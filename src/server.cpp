@@ -20,9 +20,12 @@ namespace webservice{
 		std::unique_ptr< error_handler > error_handler,
 		boost::asio::ip::address const address,
 		std::uint16_t const port,
-		std::uint8_t const thread_count
+		std::size_t const thread_count,
+		thread_options options
 	)
-		: ioc_{thread_count}
+		: own_ioc_(std::make_unique< boost::asio::io_context >(
+				executor::concurrency_hint(thread_count, options)))
+		, ioc_(*own_ioc_)
 		, impl_(std::make_unique< server_impl >(
 				*this,
 				ioc_,
@@ -31,7 +34,29 @@ namespace webservice{
 				std::move(error_handler),
 				address,
 				port,
-				thread_count
+				thread_count,
+				std::move(options)
+			)) {}
+
+	server::server(
+		std::unique_ptr< http_request_handler > http_handler,
+		std::unique_ptr< ws_handler_interface > ws_handler,
+		std::unique_ptr< error_handler > error_handler,
+		boost::asio::io_context& ioc,
+		boost::asio::ip::address const address,
+		std::uint16_t const port
+	)
+		: ioc_(ioc)
+		, impl_(std::make_unique< server_impl >(
+				*this,
+				ioc_,
+				std::move(http_handler),
+				std::move(ws_handler),
+				std::move(error_handler),
+				address,
+				port,
+				0,
+				thread_options()
 			)) {}
 
 
@@ -63,9 +88,22 @@ namespace webservice{
 	}
 
 
+	void server::resize(std::size_t const thread_count){
+		impl_->executor().resize(thread_count);
+	}
+
+	executor_stats server::stats(){
+		return impl_->executor().stats();
+	}
+
+
 	boost::asio::io_context& server::get_io_context()noexcept{
 		return ioc_;
 	}
 
+	class admission_control& server::admission()noexcept{
+		return impl_->executor().admission();
+	}
+
 
 }
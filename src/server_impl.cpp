@@ -25,14 +25,15 @@ namespace webservice{
 		std::unique_ptr< error_handler >&& error_handler,
 		boost::asio::ip::address const address,
 		std::uint16_t const port,
-		std::uint8_t thread_count
+		std::size_t thread_count,
+		thread_options options
 	)
 		: server_(server)
 		, executor_(ioc, std::move(error_handler), [this]()noexcept{
 				listener_.shutdown();
 				http().shutdown();
 				if(has_ws()){
-					ws().shutdown();
+					ws().shutdown([this]()noexcept{ ws_lock_.unlock(); });
 				}
 			})
 		, http_handler_(std::move(http_handler))
@@ -50,9 +51,13 @@ namespace webservice{
 		// Make websocket handler ready if it exists
 		if(ws_handler_){
 			ws_handler_->set_executor(executor_);
+			ws_lock_ = executor_.make_lock();
 		}
 
-		executor_.run(thread_count);
+		executor_.run(thread_count, std::move(options));
+
+		// Accept after run() to place the first session like all others
+		listener_.do_accept();
 	}
 
 
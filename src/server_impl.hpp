@@ -35,6 +35,8 @@ namespace webservice{
 		/// \param error_handler Handles error in the server_impl
 		/// \param address IP address (IPv4 or IPv6)
 		/// \param port TCP Port
+		/// \param thread_count Count of own threads, 0 if the owner of ioc
+		///                     runs it
 		server_impl(
 			class server& server,
 			boost::asio::io_context& ioc,
@@ -43,7 +45,8 @@ namespace webservice{
 			std::unique_ptr< class error_handler >&& error_handler,
 			boost::asio::ip::address address,
 			std::uint16_t port,
-			std::uint8_t thread_count
+			std::size_t thread_count,
+			thread_options options
 		);
 
 		server_impl(server_impl const&) = delete;
@@ -108,6 +111,9 @@ namespace webservice{
 		/// \brief Handler for WebSocket sessions
 		std::unique_ptr< class ws_handler_interface > ws_handler_;
 
+		/// \brief Keep the executor locked until ws_handler_ is shut down
+		async_locker::lock ws_lock_;
+
 		/// \brief Accepts incoming connections and launches the sessions
 		listener listener_;
 	};
@@ -12,6 +12,16 @@
 namespace webservice{
 
 
+	namespace{
+
+
+		/// \brief Ticket of the running server_connect() call of this thread
+		thread_local admission_control::ticket* current_ticket = nullptr;
+
+
+	}
+
+
 	ws_handler_interface::ws_handler_interface()noexcept
 		: run_lock_(locker_.make_first_lock()) {}
 
@@ -23,9 +33,19 @@ namespace webservice{
 
 	void ws_handler_interface::server_connect(
 		boost::asio::ip::tcp::socket&& socket,
-		http_request&& req
+		http_request&& req,
+		admission_control::ticket&& ticket
 	){
-		on_server_connect(std::move(socket), std::move(req));
+		// server_connect calls may nest, e.g. in ws_service_handler
+		auto const outer = current_ticket;
+		current_ticket = &ticket;
+		try{
+			on_server_connect(std::move(socket), std::move(req));
+		}catch(...){
+			current_ticket = outer;
+			throw;
+		}
+		current_ticket = outer;
 	}
 
 	void ws_handler_interface::client_connect(
@@ -58,6 +78,14 @@ namespace webservice{
 	}
 
 
+	admission_control::ticket ws_handler_interface::take_admission_ticket()
+		noexcept
+	{
+		return current_ticket
+			? std::move(*current_ticket) : admission_control::ticket();
+	}
+
+
 	class executor& ws_handler_interface::executor(){
 		if(!executor_){
 			throw std::logic_error("called executor() before set_executor()");
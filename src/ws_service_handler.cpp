@@ -8,6 +8,7 @@
 //-----------------------------------------------------------------------------
 #include <webservice/ws_service_handler.hpp>
 #include <webservice/executor.hpp>
+#include <webservice/handler_allocator.hpp>
 
 #include <boost/asio/strand.hpp>
 
@@ -67,7 +68,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -106,7 +107,7 @@ namespace webservice{
 													std::current_exception());
 											}
 										}
-									}, std::allocator< void >());
+									}, recycling_allocator< void >());
 							});
 					}else{
 						throw std::logic_error("service(" + name
@@ -115,7 +116,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -136,14 +137,15 @@ namespace webservice{
 				this,
 				lock = locker_.make_lock(),
 				socket = std::move(socket),
-				req = std::move(req)
+				req = std::move(req),
+				ticket = take_admission_ticket()
 			]()mutable noexcept{
 				try{
 					std::string name(req.target());
 					auto iter = impl_->services_.find(name);
 					if(iter != impl_->services_.end()){
 						iter->second->server_connect(std::move(socket),
-							std::move(req));
+							std::move(req), std::move(ticket));
 					}else{
 						throw std::logic_error("service(" + name
 							+ ") doesn't exist");
@@ -151,7 +153,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -183,7 +185,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -209,7 +211,7 @@ namespace webservice{
 				}
 
 				shutdown_ = true;
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -9,18 +9,70 @@
 #include <webservice/async_locker.hpp>
 #include <webservice/ws_session.hpp>
 #include <webservice/ws_service_interface.hpp>
+#include <webservice/executor.hpp>
+#include <webservice/handler_allocator.hpp>
 
 #include <boost/beast/websocket.hpp>
 
+#include <boost/version.hpp>
+
+#include <boost/optional.hpp>
+
 #include <boost/asio/strand.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/steady_timer.hpp>
-#include <boost/asio/bind_executor.hpp>
 
 
 namespace webservice{
 
 
+	struct ws_session::send_node{
+		/// \brief Next older entry
+		send_node* next;
+
+		/// \brief The message, empty for a batch
+		boost::optional< write_data > message;
+
+		/// \brief Batch of a send_many() call
+		std::shared_ptr< ws_send_batch const > batch;
+
+		/// \brief Range of the messages in batch
+		std::size_t first;
+		std::size_t last;
+	};
+
+
+	namespace{
+
+
+		using send_node_allocator = recycling_allocator< char >;
+
+
+		/// \brief Construct a send queue entry in recycled memory
+		template < typename Node, typename ... Args >
+		Node* make_send_node(Args&& ... args){
+			auto const memory =
+				send_node_allocator().allocate(sizeof(Node));
+			try{
+				return new(memory) Node{static_cast< Args&& >(args) ...};
+			}catch(...){
+				send_node_allocator().deallocate(memory, sizeof(Node));
+				throw;
+			}
+		}
+
+		/// \brief Destroy a send queue entry
+		template < typename Node >
+		void destroy_send_node(Node* node)noexcept{
+			node->~Node();
+			send_node_allocator().deallocate(
+				reinterpret_cast< char* >(node), sizeof(Node));
+		}
+
+
+	}
+
+
 	ws_session::ws_session(
 		ws_stream&& ws,
 		ws_service_interface& service,
@@ -28,9 +80,10 @@ namespace webservice{
 	)
 		: service_(service)
 		, ws_(std::move(ws))
-		, strand_(ws_.get_executor())
-		, handler_strand_(ws_.get_executor())
-		, timer_(ws_.get_executor().context(),
+		, strand_(executor::io_context_of(ws_.next_layer()).get_executor())
+		, handler_strand_(
+			executor::io_context_of(ws_.next_layer()).get_executor())
+		, timer_(executor::io_context_of(ws_.next_layer()),
 			std::chrono::steady_clock::time_point::max())
 		, locker_([this]()noexcept{
 				service_.on_erase(ws_identifier(*this));
@@ -47,12 +100,25 @@ namespace webservice{
 				// Note that there is activity
 				activity();
 			});
+
+		service_.executor().admission().session_opened();
+		service_.executor().session_opened(ws_.get_executor().context());
 	}
 
 	ws_session::~ws_session(){
+		auto node = send_queue_.exchange(nullptr, std::memory_order_acquire);
+		while(node){
+			auto const next = node->next;
+			destroy_send_node(node);
+			node = next;
+		}
+
 		if(is_open_){
 			on_close();
 		}
+
+		service_.executor().session_closed(ws_.get_executor().context());
+		service_.executor().admission().session_closed();
 	}
 
 
@@ -62,29 +128,55 @@ namespace webservice{
 
 		start_timer();
 
+		auto& admission = service_.executor().admission();
+		admission.handshake_started();
+
+		// Announce the negotiated subprotocol in the handshake response
+		auto decorate = [this](boost::beast::websocket::response_type& res){
+				if(!subprotocol_.empty()){
+					res.set(boost::beast::http::field::sec_websocket_protocol,
+						subprotocol_);
+				}
+			};
+
 		// Accept the WebSocket handshake
-		ws_.async_accept(
-			std::move(req),
-			boost::asio::bind_executor(
-				strand_,
-				[this, lock = locker_.make_lock()]
-				(boost::system::error_code ec){
-					// Happens when the timer closes the socket
-					if(ec == boost::asio::error::operation_aborted){
-						return;
-					}
+		try{
+#if BOOST_VERSION >= 107000
+			ws_.set_option(boost::beast::websocket::stream_base::decorator(
+				std::move(decorate)));
+			ws_.async_accept(
+				std::move(req),
+#else
+			ws_.async_accept_ex(
+				std::move(req),
+				std::move(decorate),
+#endif
+				bind_recycling(
+					strand_,
+					[this, lock = locker_.make_lock(), &admission]
+					(boost::system::error_code ec){
+						admission.handshake_finished();
 
-					if(ec){
-						on_error("accept", ec);
-						return;
-					}
+						// Happens when the timer closes the socket
+						if(ec == boost::asio::error::operation_aborted){
+							return;
+						}
 
-					is_open_ = true;
-					on_open();
+						if(ec){
+							on_error("accept", ec);
+							return;
+						}
 
-					// Read a message
-					do_read();
-				}));
+						is_open_ = true;
+						on_open();
+
+						// Read a message
+						do_read();
+					}));
+		}catch(...){
+			admission.handshake_finished();
+			throw;
+		}
 	}catch(...){
 		close_socket();
 		throw;
@@ -109,37 +201,103 @@ namespace webservice{
 
 	void ws_session::send(
 		bool is_text,
-		shared_const_buffer data
+		shared_const_buffer data,
+		ws_write_handler handler
+	)noexcept try{
+		auto lock = locker_.make_lock();
+		push_send(make_send_node< send_node >(nullptr,
+			boost::optional< write_data >(
+				write_data{is_text, std::move(data), std::move(handler)}),
+			std::shared_ptr< ws_send_batch const >(), std::size_t(0),
+			std::size_t(0)), std::move(lock));
+	}catch(...){
+		on_exception(std::current_exception());
+	}
+
+	void ws_session::send(
+		std::shared_ptr< ws_send_batch const > batch,
+		std::size_t const first,
+		std::size_t const last
 	)noexcept try{
+		auto lock = locker_.make_lock();
+		push_send(make_send_node< send_node >(nullptr,
+			boost::optional< write_data >(), std::move(batch), first, last), std::move(lock));
+	}catch(...){
+		on_exception(std::current_exception());
+	}
+
+	void ws_session::push_send(send_node* node, async_locker::lock&& lock){
+		auto head = send_queue_.load(std::memory_order_relaxed);
+		do{
+			node->next = head;
+		}while(!send_queue_.compare_exchange_weak(head, node,
+			std::memory_order_release, std::memory_order_relaxed));
+
+		// Any other producer found a non-empty queue, so the writer is
+		// already scheduled
+		if(head != nullptr){
+			return;
+		}
+
 		strand_.dispatch(
-			[
-				this, lock = locker_.make_lock(),
-				is_text,
-				data = std::move(data)
-			]()mutable{
-				if(!ws_.is_open()){
-					timer_.cancel();
-					return;
-				}
+			[this, lock = std::move(lock)]{
+				drain_send_queue();
+			}, recycling_allocator< void >());
+	}
 
-				if(close_reason_){
-					return;
-				}
+	void ws_session::drain_send_queue(){
+		// Take all entries and restore their order
+		auto node = send_queue_.exchange(nullptr, std::memory_order_acquire);
+		send_node* first = nullptr;
+		while(node){
+			auto const next = node->next;
+			node->next = first;
+			first = node;
+			node = next;
+		}
 
-				if(write_list_.full()){
-					throw std::runtime_error("write buffer is full");
-				}
+		if(!ws_.is_open()){
+			timer_.cancel();
+		}
 
-				bool was_empty = write_list_.empty();
+		bool const accept = ws_.is_open() && !close_reason_;
+		bool const was_empty = write_list_.empty();
+		bool full = false;
 
-				write_list_.push_back(write_data{is_text, std::move(data)});
+		for(node = first; node != nullptr;){
+			if(accept && !full){
+				if(node->message){
+					if(write_list_.full()){
+						full = true;
+					}else{
+						write_list_.push_back(std::move(*node->message));
+					}
+				}else{
+					for(auto i = node->first; i < node->last; ++i){
+						if(write_list_.full()){
+							full = true;
+							break;
+						}
 
-				if(was_empty){
-					do_write();
+						auto const& message = (*node->batch)[i];
+						write_list_.push_back(write_data{message.is_text,
+							message.data, ws_write_handler()});
+					}
 				}
-			}, std::allocator< void >());
-	}catch(...){
-		on_exception(std::current_exception());
+			}
+
+			auto const next = node->next;
+			destroy_send_node(node);
+			node = next;
+		}
+
+		if(was_empty && !write_list_.empty()){
+			do_write();
+		}
+
+		if(full){
+			throw std::runtime_error("write buffer is full");
+		}
 	}
 
 	void ws_session::close(
@@ -150,6 +308,14 @@ namespace webservice{
 				this, lock = locker_.make_lock(),
 				reason
 			]{
+				// A message pushed before the close may still wait for its
+				// drain_send_queue() call, it must not be rejected
+				try{
+					drain_send_queue();
+				}catch(...){
+					on_exception(std::current_exception());
+				}
+
 				if(!ws_.is_open()){
 					timer_.cancel();
 					return;
@@ -165,7 +331,7 @@ namespace webservice{
 				if(write_list_.empty()){
 					do_write();
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -177,7 +343,7 @@ namespace webservice{
 	}
 
 	void ws_session::do_timer(){
-		timer_.async_wait(boost::asio::bind_executor(
+		timer_.async_wait(bind_recycling(
 			strand_,
 			[this, lock = locker_.make_lock()]
 			(boost::system::error_code ec){
@@ -204,7 +370,7 @@ namespace webservice{
 					ws_.async_ping(
 						boost::beast::websocket::ping_data(
 							ping_payload.c_str(), ping_payload.size()),
-						boost::asio::bind_executor(
+						bind_recycling(
 							strand_,
 							[this, lock = locker_.make_lock()](
 								boost::system::error_code ec
@@ -277,7 +443,7 @@ namespace webservice{
 		// Read a message into our buffer
 		ws_.async_read(
 			buffer_,
-			boost::asio::bind_executor(
+			bind_recycling(
 				strand_,
 				[this, lock = locker_.make_lock()](
 					boost::system::error_code ec,
@@ -325,8 +491,9 @@ namespace webservice{
 
 
 	void ws_session::do_write(){
-		if(close_reason_){
-			ws_.async_close(*close_reason_, boost::asio::bind_executor(
+		// Messages that were sent before the close are written first
+		if(write_list_.empty()){
+			ws_.async_close(*close_reason_, bind_recycling(
 				strand_,
 				[this, lock = locker_.make_lock()](
 					boost::system::error_code ec
@@ -343,7 +510,7 @@ namespace webservice{
 			ws_.text(write_list_.front().is_text);
 			ws_.async_write(
 				std::move(write_list_.front().data),
-				boost::asio::bind_executor(
+				bind_recycling(
 					strand_,
 					[this, lock = locker_.make_lock()](
 						boost::system::error_code ec,
@@ -354,11 +521,13 @@ namespace webservice{
 						}
 
 						if(ec){
+							write_list_.front().handler(ec);
 							on_error("write", ec);
 							close("write error");
 							return;
 						}
 
+						auto handler = std::move(write_list_.front().handler);
 						write_list_.pop_front();
 
 						if(
@@ -367,6 +536,8 @@ namespace webservice{
 						){
 							do_write();
 						}
+
+						handler(ec);
 					}));
 		}
 	}
@@ -380,7 +551,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -404,7 +575,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
@@ -422,7 +593,7 @@ namespace webservice{
 				}catch(...){
 					on_exception(std::current_exception());
 				}
-			}, std::allocator< void >());
+			}, recycling_allocator< void >());
 	}catch(...){
 		on_exception(std::current_exception());
 	}
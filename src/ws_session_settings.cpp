@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/ws_session_settings.hpp>
+
+
+namespace webservice{
+
+
+	namespace{
+
+
+		bool is_space(char c){
+			return c == ' ' || c == '\t';
+		}
+
+		/// \brief Remove leading and trailing spaces and tabs
+		boost::string_view trim(boost::string_view text){
+			while(!text.empty() && is_space(text.front())){
+				text.remove_prefix(1);
+			}
+			while(!text.empty() && is_space(text.back())){
+				text.remove_suffix(1);
+			}
+			return text;
+		}
+
+		/// \brief true if protocol is in the comma separated list offered
+		bool is_offered(
+			boost::string_view offered,
+			boost::string_view protocol
+		){
+			while(!offered.empty()){
+				auto const pos = offered.find(',');
+				if(trim(offered.substr(0, pos)) == protocol){
+					return true;
+				}
+
+				if(pos == boost::string_view::npos){
+					break;
+				}
+
+				offered.remove_prefix(pos + 1);
+			}
+			return false;
+		}
+
+
+	}
+
+
+	std::string ws_session_settings::select_subprotocol(
+		boost::string_view offered
+	)const{
+		for(auto const& protocol: subprotocols_){
+			if(is_offered(offered, protocol)){
+				return protocol;
+			}
+		}
+		return {};
+	}
+
+
+}
@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/webservice
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/ws_tag_index.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace webservice{
+
+
+	void ws_tag_index::insert(
+		ws_session& session,
+		std::uint64_t tags,
+		std::size_t& slot
+	){
+		tags_.push_back(tags);
+		try{
+			sessions_.push_back(&session);
+			try{
+				slots_.push_back(&slot);
+			}catch(...){
+				sessions_.pop_back();
+				throw;
+			}
+		}catch(...){
+			tags_.pop_back();
+			throw;
+		}
+
+		slot = tags_.size() - 1;
+	}
+
+	void ws_tag_index::erase(std::size_t slot)noexcept{
+		// Move the last session into the gap
+		std::size_t const last = tags_.size() - 1;
+		if(slot != last){
+			tags_[slot] = tags_[last];
+			sessions_[slot] = sessions_[last];
+			slots_[slot] = slots_[last];
+			*slots_[slot] = slot;
+		}
+
+		tags_.pop_back();
+		sessions_.pop_back();
+		slots_.pop_back();
+	}
+
+
+	std::uint64_t ws_tag_index::match(
+		std::uint64_t const* tags,
+		std::size_t const count,
+		tag_filter const filter
+	)noexcept{
+		// 'all' and 'none' compare the masked bits for equality, 'any' is the
+		// negation of 'none'
+		std::uint64_t const expected =
+			filter.mode == tag_match::all ? filter.mask : 0;
+
+		std::uint64_t result = 0;
+		std::size_t i = 0;
+
+#if defined(__AVX2__)
+		__m256i const mask = _mm256_set1_epi64x(
+			static_cast< long long >(filter.mask));
+		__m256i const cmp = _mm256_set1_epi64x(
+			static_cast< long long >(expected));
+		for(; i + 4 <= count; i += 4){
+			__m256i const value = _mm256_loadu_si256(
+				reinterpret_cast< __m256i const* >(tags + i));
+			__m256i const eq = _mm256_cmpeq_epi64(
+				_mm256_and_si256(value, mask), cmp);
+			result |= static_cast< std::uint64_t >(
+				_mm256_movemask_pd(_mm256_castsi256_pd(eq))) << i;
+		}
+#elif defined(__SSE2__)
+		__m128i const mask = _mm_set1_epi64x(
+			static_cast< long long >(filter.mask));
+		__m128i const cmp = _mm_set1_epi64x(
+			static_cast< long long >(expected));
+		for(; i + 2 <= count; i += 2){
+			__m128i const value = _mm_loadu_si128(
+				reinterpret_cast< __m128i const* >(tags + i));
+			// SSE2 has no 64 bit compare, so both 32 bit halves must be equal
+			__m128i const eq32 = _mm_cmpeq_epi32(
+				_mm_and_si128(value, mask), cmp);
+			__m128i const eq = _mm_and_si128(eq32,
+				_mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+			result |= static_cast< std::uint64_t >(
+				_mm_movemask_pd(_mm_castsi128_pd(eq))) << i;
+		}
+#endif
+
+		for(; i < count; ++i){
+			result |= static_cast< std::uint64_t >(
+				(tags[i] & filter.mask) == expected) << i;
+		}
+
+		if(filter.mode == tag_match::any){
+			std::uint64_t const valid =
+				count == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+			result ^= valid;
+		}
+
+		return result;
+	}
+
+
+}
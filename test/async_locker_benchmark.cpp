@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/async_locker.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+/// \brief The former sequentially consistent implementation for comparison
+class legacy_async_locker{
+public:
+	class lock{
+	public:
+		lock()
+			: locker_(nullptr) {}
+
+		lock(legacy_async_locker& locker)
+			: locker_(&locker)
+		{
+			if((*locker_).lock_count_ == 0){
+				throw std::runtime_error("async call after shutdown");
+			}
+
+			++(*locker_).lock_count_;
+		}
+
+		lock(lock&& other)noexcept
+			: locker_(other.locker_.exchange(
+				nullptr, std::memory_order_relaxed)) {}
+
+		~lock(){
+			unlock();
+		}
+
+		bool is_locked()const noexcept{
+			return locker_ != nullptr;
+		}
+
+		void unlock()noexcept{
+			auto locker =
+				locker_.exchange(nullptr, std::memory_order_relaxed);
+			if(locker && --locker->lock_count_ == 0){
+				if(locker->on_last_async_callback_){
+					locker->on_last_async_callback_();
+				}
+			}
+		}
+
+	private:
+		std::atomic< legacy_async_locker* > locker_;
+	};
+
+
+	lock make_first_lock(){
+		std::size_t expected = 0;
+		if(!lock_count_.compare_exchange_strong(expected, 1,
+			std::memory_order_relaxed)
+		){
+			throw std::logic_error(
+				"async_locker::first_lock() called after first lock.");
+		}
+
+		lock result(*this);
+		--lock_count_;
+		return result;
+	}
+
+	lock make_lock(){
+		return lock(*this);
+	}
+
+private:
+	std::function< void() > on_last_async_callback_;
+	std::atomic< std::size_t > lock_count_{0};
+};
+
+
+/// \brief Prevent the compiler from optimizing the locks away
+std::atomic< std::size_t > sink{0};
+
+
+template < typename Fn >
+void measure(char const* name, std::size_t count, Fn&& fn){
+	auto const start = std::chrono::steady_clock::now();
+	fn(count);
+	auto const end = std::chrono::steady_clock::now();
+
+	auto const ns = std::chrono::duration< double, std::nano >(
+		end - start).count() / count;
+	std::cout << std::setw(44) << std::left << name
+		<< std::setw(10) << std::right << std::fixed
+		<< std::setprecision(1) << ns << " ns\n";
+}
+
+
+/// \brief Simulate an async operation that moves its lock through a chain
+///        of handlers like a lambda capture in a composed operation
+template < typename Lock >
+bool handler_chain(Lock lock){
+	auto first = std::move(lock);
+	auto second = std::move(first);
+	Lock third(std::move(second));
+	return third.is_locked();
+}
+
+
+template < typename Locker >
+void run(char const* name){
+	constexpr std::size_t count = 10000000;
+
+	std::cout << name << ":\n";
+
+	Locker locker;
+	auto first_lock = locker.make_first_lock();
+
+	measure("  make_lock + unlock", count, [&locker](std::size_t count){
+			std::size_t locked = 0;
+			for(std::size_t i = 0; i < count; ++i){
+				auto lock = locker.make_lock();
+				locked += lock.is_locked();
+			}
+			sink += locked;
+		});
+
+	measure("  make_lock + 3 moves + unlock", count,
+		[&locker](std::size_t count){
+			std::size_t locked = 0;
+			for(std::size_t i = 0; i < count; ++i){
+				locked += handler_chain(locker.make_lock());
+			}
+			sink += locked;
+		});
+
+	auto const thread_count = std::max(2u, std::thread::hardware_concurrency());
+	measure("  make_lock + unlock, all threads", count,
+		[&locker, thread_count](std::size_t count){
+			std::vector< std::thread > threads;
+			for(std::size_t i = 0; i < thread_count; ++i){
+				threads.emplace_back([&locker, count, thread_count]{
+						std::size_t locked = 0;
+						for(std::size_t i = 0; i < count / thread_count; ++i){
+							locked += handler_chain(locker.make_lock());
+						}
+						sink += locked;
+					});
+			}
+			for(auto& thread: threads){
+				thread.join();
+			}
+		});
+}
+
+
+int main(){
+	run< legacy_async_locker >("seq_cst async_locker (former)");
+	run< webservice::async_locker >("async_locker");
+
+	std::cout << "(" << sink << ")\n";
+}
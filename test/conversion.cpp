@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/conversion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Write size bytes from data in parts of part_size bytes, one
+///        segment per part, starting offset bytes into the first segment
+boost::beast::multi_buffer make_buffer(
+	void const* data,
+	std::size_t size,
+	std::size_t part_size,
+	std::size_t offset = 0
+){
+	auto const bytes = static_cast< char const* >(data);
+	boost::beast::multi_buffer result;
+	if(offset > 0){
+		result.prepare(offset);
+		result.commit(offset);
+	}
+	for(std::size_t i = 0; i < size; i += part_size){
+		auto const part = std::min(part_size, size - i);
+		result.commit(boost::asio::buffer_copy(
+			result.prepare(part), boost::asio::buffer(bytes + i, part)));
+	}
+	result.consume(offset);
+	return result;
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	std::vector< std::uint32_t > values(1000);
+	std::iota(values.begin(), values.end(), 0x12345678);
+	auto const bytes = values.size() * sizeof(std::uint32_t);
+
+	{
+		std::string const text = "segmented text message";
+		auto const buffer = make_buffer(text.data(), text.size(), 5);
+		std::cout << "string from segments: " << bool_{
+				webservice::from_multi_buffer_t< std::string >{}(buffer)
+				== text}
+			<< '\n';
+	}
+
+	{
+		webservice::from_multi_buffer_t< std::vector< std::uint32_t > >
+			const convert;
+		std::cout << "vector contiguous: " << bool_{
+				convert(make_buffer(values.data(), bytes, bytes)) == values}
+			<< '\n';
+		std::cout << "vector split inside elements: " << bool_{
+				convert(make_buffer(values.data(), bytes, 1001)) == values}
+			<< '\n';
+
+		std::string error;
+		try{
+			convert(make_buffer(values.data(), bytes - 1, bytes));
+		}catch(std::exception const& e){
+			error = e.what();
+		}
+		std::cout << "vector rejects partial element: "
+			<< bool_{!error.empty()} << '\n';
+	}
+
+	{
+		webservice::multi_buffer_span< std::uint32_t > const span(
+			make_buffer(values.data(), bytes, bytes));
+		std::cout << "span contiguous is zero copy: " << bool_{
+				span.is_zero_copy() && span.size() == values.size() &&
+				std::equal(span.begin(), span.end(), values.begin())}
+			<< '\n';
+	}
+
+	{
+		webservice::multi_buffer_span< std::uint32_t > const span(
+			make_buffer(values.data(), bytes, 1001));
+		std::cout << "span segmented is copied: " << bool_{
+				!span.is_zero_copy() && span.size() == values.size() &&
+				std::equal(span.begin(), span.end(), values.begin())}
+			<< '\n';
+	}
+
+	{
+		auto buffer = make_buffer(values.data(), bytes, bytes, 1);
+		auto const data = buffer.data();
+		auto const first = boost::asio::const_buffer(
+			*boost::asio::buffer_sequence_begin(data)).data();
+		auto const misaligned =
+			reinterpret_cast< std::uintptr_t >(first) % alignof(std::uint32_t)
+			!= 0;
+
+		webservice::multi_buffer_span< std::uint32_t > const span(
+			std::move(buffer));
+		std::cout << "span misaligned is copied: " << bool_{
+				misaligned && !span.is_zero_copy() &&
+				span.size() == values.size() && span[999] == values[999]}
+			<< '\n';
+	}
+
+	{
+		webservice::multi_buffer_span< std::uint32_t > const span(
+			boost::beast::multi_buffer{});
+		std::cout << "span empty: " << bool_{span.empty()} << '\n';
+	}
+
+	for(auto const segment: {bytes, std::size_t(1001)}){
+		auto source = std::make_unique<
+			webservice::multi_buffer_span< std::uint32_t > >(
+				make_buffer(values.data(), bytes, segment));
+		webservice::multi_buffer_span< std::uint32_t > copy(*source);
+		webservice::multi_buffer_span< std::uint32_t > assigned(
+			boost::beast::multi_buffer{});
+		assigned = *source;
+		source.reset();
+		std::cout << "span copy outlives source"
+			<< (segment == bytes ? "" : ", segmented") << ": " << bool_{
+				copy.size() == values.size() &&
+				std::equal(copy.begin(), copy.end(), values.begin()) &&
+				std::equal(assigned.begin(), assigned.end(), values.begin())}
+			<< '\n';
+	}
+}
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/executor.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+int main(){
+	using namespace std::literals::chrono_literals;
+
+	std::cout << std::boolalpha;
+
+	// One pool runs the io_context of two executors
+	boost::asio::io_context ioc(2);
+	auto work = boost::asio::make_work_guard(ioc);
+	std::thread pool1([&ioc]{ ioc.run(); });
+	std::thread pool2([&ioc]{ ioc.run(); });
+
+	{
+		std::atomic< bool > finished{false};
+		webservice::executor executor1(ioc, nullptr, []()noexcept{});
+		webservice::executor executor2(ioc, nullptr, []()noexcept{});
+		executor1.run(0);
+		executor2.run(0);
+
+		bool resize_throws = false;
+		try{
+			executor1.resize(2);
+		}catch(std::logic_error const&){
+			resize_throws = true;
+		}
+
+		bool options_throw = false;
+		try{
+			webservice::executor executor3(ioc, nullptr, []()noexcept{});
+			executor3.run(0, webservice::session_placement::round_robin);
+		}catch(std::logic_error const&){
+			options_throw = true;
+		}
+
+		std::cout << "no own threads: "
+			<< bool_{
+				executor1.thread_count() == 0 &&
+				resize_throws &&
+				options_throw} << '\n';
+
+		// block() waits for the async operation
+		boost::asio::post(ioc,
+			[&finished, lock = executor1.make_lock()]{
+				std::this_thread::sleep_for(100ms);
+				finished = true;
+			});
+
+		executor1.shutdown();
+		executor1.block();
+		std::cout << "block waits on locks: "
+			<< bool_{finished && executor1.is_stopped()} << '\n';
+
+		// the other executor is still running
+		std::cout << "independent executors: "
+			<< bool_{!executor2.is_stopped()} << '\n';
+
+		executor2.shutdown();
+		executor2.block();
+		std::cout << "second executor stopped: "
+			<< bool_{executor2.is_stopped() && !ioc.stopped()} << '\n';
+	}
+
+	work.reset();
+	pool1.join();
+	pool2.join();
+}
@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/executor.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief true if predicate becomes true within 5 seconds
+template < typename Predicate >
+bool wait_for(Predicate&& predicate){
+	using namespace std::literals::chrono_literals;
+	for(std::size_t i = 0; i < 500; ++i){
+		if(predicate()){
+			return true;
+		}
+		std::this_thread::sleep_for(10ms);
+	}
+	return predicate();
+}
+
+
+int main(){
+	using namespace std::literals::chrono_literals;
+
+	std::cout << std::boolalpha;
+
+	{
+		boost::asio::io_context ioc(2);
+		webservice::executor executor(ioc, nullptr, []()noexcept{});
+		executor.run(2);
+
+		bool thrown = false;
+		try{
+			executor.resize(3);
+		}catch(std::logic_error const&){
+			thrown = true;
+		}
+
+		std::cout << "resize above concurrency hint: "
+			<< bool_{thrown && executor.thread_count() == 2} << '\n';
+
+		executor.shutdown();
+		executor.block();
+	}
+
+	{
+		boost::asio::io_context ioc(4);
+		webservice::executor executor(ioc, nullptr, []()noexcept{});
+		executor.run(4);
+
+		executor.resize(1);
+		auto const shrunk = wait_for([&executor]{
+				return executor.stats().threads.size() == 1;
+			});
+
+		// The remaining thread still runs handlers
+		std::atomic< std::size_t > handlers{0};
+		for(std::size_t i = 0; i < 100; ++i){
+			boost::asio::post(ioc, [&handlers]{ ++handlers; });
+		}
+		auto const running = wait_for([&handlers]{
+				return handlers == 100;
+			});
+
+		std::cout << "shrink: "
+			<< bool_{shrunk && running && executor.thread_count() == 1}
+			<< '\n';
+
+		executor.resize(4);
+		auto const grown = wait_for([&executor]{
+				return executor.stats().threads.size() == 4;
+			});
+
+		std::cout << "grow: "
+			<< bool_{grown && executor.thread_count() == 4} << '\n';
+
+		// Shrink and grow again before the threads could retire
+		executor.resize(2);
+		executor.resize(4);
+		executor.resize(3);
+		auto const settled = wait_for([&executor]{
+				return executor.stats().threads.size() == 3;
+			});
+
+		std::cout << "resize in a row: "
+			<< bool_{settled && executor.thread_count() == 3} << '\n';
+
+		executor.shutdown();
+		executor.block();
+	}
+
+	{
+		boost::asio::io_context ioc(3);
+		webservice::executor executor(ioc, nullptr, []()noexcept{});
+		webservice::thread_options options;
+		options.max_threads = 3;
+		options.grow_lag = 1ms;
+		options.shrink_lag = 50ms;
+		options.shrink_delay = 300ms;
+		executor.run(1, options);
+
+		// Chains of blocking handlers delay the probes until stopped
+		std::atomic< bool > load{true};
+		std::atomic< std::size_t > chains{0};
+		std::function< void() > block_handler = [&]{
+				std::this_thread::sleep_for(5ms);
+				if(load){
+					boost::asio::post(ioc, block_handler);
+				}else{
+					--chains;
+				}
+			};
+		for(std::size_t i = 0; i < 8; ++i){
+			++chains;
+			boost::asio::post(ioc, block_handler);
+		}
+
+		auto const grown = wait_for([&executor]{
+				return executor.thread_count() == 3;
+			});
+
+		load = false;
+		wait_for([&chains]{ return chains == 0; });
+
+		std::cout << "elastic grow: " << bool_{grown} << '\n';
+
+		// Without load the probes are calm
+		auto const shrunk = wait_for([&executor]{
+				return executor.thread_count() == 1 &&
+					executor.stats().threads.size() == 1;
+			});
+
+		std::cout << "elastic shrink: " << bool_{shrunk} << '\n';
+
+		executor.shutdown();
+		executor.block();
+	}
+}
@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/executor.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+int main(){
+	using namespace std::literals::chrono_literals;
+	using webservice::executor_stats;
+
+	std::cout << std::boolalpha;
+
+	{
+		std::cout << "lag buckets: "
+			<< bool_{
+				executor_stats::lag_bucket(0us) == 0 &&
+				executor_stats::lag_bucket(1us) == 0 &&
+				executor_stats::lag_bucket(2us) == 1 &&
+				executor_stats::lag_bucket(3us) == 1 &&
+				executor_stats::lag_bucket(1024us) == 10 &&
+				executor_stats::lag_bucket(1h) ==
+					executor_stats::bucket_count - 1} << '\n';
+	}
+
+	{
+		executor_stats stats{};
+		stats.lag_histogram[3] = 90;
+		stats.lag_histogram[10] = 9;
+		stats.lag_histogram[executor_stats::bucket_count - 1] = 1;
+		stats.probes = 100;
+		stats.max_lag = 20s;
+		std::cout << "lag quantiles: "
+			<< bool_{
+				stats.lag_quantile(0.5) == 16us &&
+				stats.lag_quantile(0.99) == 2048us &&
+				stats.lag_quantile(1) == 20s &&
+				executor_stats{}.lag_quantile(0.5) == 0us} << '\n';
+	}
+
+	{
+		boost::asio::io_context ioc(2);
+		auto work = boost::asio::make_work_guard(ioc);
+		webservice::executor executor(ioc, nullptr, [&work]()noexcept{
+				work.reset();
+			});
+		webservice::thread_options options;
+		options.measure_lag = true;
+		executor.run(2, options);
+
+		for(std::size_t i = 0; i < 100; ++i){
+			boost::asio::post(ioc, []{ std::this_thread::sleep_for(1ms); });
+		}
+
+		// Wait for some lag probes
+		std::this_thread::sleep_for(500ms);
+
+		auto const stats = executor.stats();
+		std::uint64_t handlers = 0;
+		for(auto const& thread: stats.threads){
+			handlers += thread.handlers;
+		}
+
+		std::cout << "executor statistics: "
+			<< bool_{
+				stats.threads.size() == 2 &&
+				handlers >= 100 + stats.probes &&
+				stats.probes > 0 &&
+				stats.max_lag >= stats.last_lag} << '\n';
+
+		executor.shutdown();
+		executor.block();
+	}
+}
@@ -0,0 +1,130 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <fixed_message.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+using test_messages::sensor_update;
+
+
+/// \brief Receive buffer in parts of part_size bytes, one segment per part
+boost::beast::multi_buffer receive(
+	webservice::shared_const_buffer const& message,
+	std::size_t part_size
+){
+	std::string data(message.size(), '\0');
+	boost::asio::buffer_copy(boost::asio::buffer(&data[0], data.size()),
+		message);
+
+	boost::beast::multi_buffer result;
+	for(std::size_t i = 0; i < data.size(); i += part_size){
+		auto const size = std::min(part_size, data.size() - i);
+		result.commit(boost::asio::buffer_copy(
+			result.prepare(size), boost::asio::buffer(&data[i], size)));
+	}
+	return result;
+}
+
+bool check(sensor_update::view const& view){
+	return view.id() == 0x01020304
+		&& view.value() == -2.5
+		&& view.valid()
+		&& view.channels(0) == -1
+		&& view.channels(1) == 0
+		&& view.channels(2) == 1000
+		&& view.name() == "sensor";
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	constexpr webservice::to_shared_const_buffer_t< sensor_update::builder >
+		to_buffer{};
+	constexpr webservice::from_multi_buffer_t< sensor_update::view >
+		to_view{};
+
+	sensor_update::builder builder;
+	builder.id(0x01020304).value(-2.5).valid(true).name("sensor");
+	for(std::size_t i = 0; i < sensor_update::builder::channels_size(); ++i){
+		builder.channels(i, static_cast< std::int16_t >(
+			i == 0 ? -1 : i == 1 ? 0 : 1000));
+	}
+	auto const message = to_buffer(std::move(builder));
+
+	std::cout << "wire size: " << bool_{message.size() == 27 &&
+			sensor_update::view::wire_size == 27}
+		<< '\n';
+
+	{
+		unsigned char first[4];
+		boost::asio::buffer_copy(boost::asio::buffer(first), message);
+		std::cout << "little endian: " << bool_{first[0] == 4 &&
+				first[1] == 3 && first[2] == 2 && first[3] == 1}
+			<< '\n';
+	}
+
+	{
+		auto buffer = receive(message, 27);
+		auto const data = buffer.data();
+		auto const first = boost::asio::const_buffer(
+			*boost::asio::buffer_sequence_begin(data)).data();
+
+		auto const view = to_view(std::move(buffer));
+		std::cout << "contiguous in place: " << bool_{
+				view.data() == first && check(view)}
+			<< '\n';
+	}
+
+	{
+		auto view = to_view(receive(message, 5));
+		auto const moved = std::move(view);
+		std::cout << "segmented copied and moved: " << bool_{check(moved)}
+			<< '\n';
+	}
+
+	{
+		sensor_update::builder builder;
+		builder.name("a name longer than eight");
+		auto const view = to_view(receive(to_buffer(std::move(builder)), 27));
+		std::cout << "text truncated: " << bool_{
+				view.name() == "a name l" && view.id() == 0 && !view.valid()}
+			<< '\n';
+	}
+
+	{
+		boost::beast::multi_buffer buffer;
+		buffer.commit(boost::asio::buffer_copy(
+			buffer.prepare(3), boost::asio::buffer("abc", 3)));
+		std::string error;
+		try{
+			to_view(std::move(buffer));
+		}catch(std::exception const& e){
+			error = e.what();
+		}
+		std::cout << "wrong size rejected: " << bool_{!error.empty()}
+			<< '\n';
+	}
+}
@@ -0,0 +1,214 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include "error_printing_ws_service.hpp"
+#include "error_printing_error_handler.hpp"
+#include "error_printing_request_handler.hpp"
+
+#include <webservice/handler_allocator.hpp>
+#include <webservice/server.hpp>
+#include <webservice/ws_service.hpp>
+#include <webservice/client.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/// \brief Count of calls to operator new
+std::atomic< std::size_t > allocations{0};
+
+void* operator new(std::size_t size){
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* result = std::malloc(size ? size : 1)){
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer)noexcept{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t)noexcept{
+	std::free(pointer);
+}
+
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Messages before counting starts
+constexpr int warm_up = 10000;
+
+/// \brief Counted messages
+constexpr int measured = 10000;
+
+/// \brief Max allocations per echoed message
+///
+/// One receive buffer on each side; all handlers are recycled.
+constexpr std::size_t max_allocations = 2;
+
+
+std::size_t allocations_at_start = 0;
+std::size_t allocations_at_end = 0;
+
+
+struct ws_service
+	: webservice::error_printing_ws_service< webservice::ws_service >
+{
+	int count = 0;
+
+	void on_open(webservice::ws_identifier)override{
+		send_text("0");
+	}
+
+	void on_close(webservice::ws_identifier)override{
+		executor().shutdown();
+	}
+
+	void on_text(
+		webservice::ws_identifier,
+		std::string&& text
+	)override{
+		if(text != std::to_string(count)){
+			std::cout << "\033[1;31mfail: server expected '" << count
+				<< "' but got '" << text << "'\033[0m\n";
+			close("shutdown");
+			return;
+		}
+
+		if(count == warm_up){
+			allocations_at_start = allocations.load();
+		}else if(count == warm_up + measured){
+			allocations_at_end = allocations.load();
+			close("shutdown");
+			return;
+		}
+
+		send_text(std::to_string(++count));
+	}
+};
+
+
+struct ws_client_service
+	: webservice::error_printing_ws_service< webservice::ws_service >
+{
+	void on_text(
+		webservice::ws_identifier,
+		std::string&& text
+	)override{
+		send_text(std::move(text));
+	}
+};
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	{
+		webservice::recycling_allocator< char > allocator;
+		for(std::size_t size: {1, 64, 100, 1000, 4096}){
+			allocator.deallocate(allocator.allocate(size), size);
+		}
+
+		auto const before = allocations.load();
+		for(std::size_t i = 0; i < 1000; ++i){
+			for(std::size_t size: {1, 64, 100, 1000, 4096}){
+				allocator.deallocate(allocator.allocate(size), size);
+			}
+		}
+		std::cout << "recycled without operator new: "
+			<< bool_{allocations.load() == before} << '\n';
+
+		auto const big = allocations.load();
+		allocator.deallocate(allocator.allocate(2 << 20), 2 << 20);
+		std::cout << "big blocks use operator new: "
+			<< bool_{allocations.load() == big + 1} << '\n';
+	}
+
+	{
+		// A producer thread gets back the blocks that a consumer freed
+		webservice::recycling_allocator< int > allocator;
+		std::vector< int* > blocks;
+		std::promise< void > produced;
+		std::promise< void > consumed;
+		auto produced_future = produced.get_future();
+		auto consumed_future = consumed.get_future();
+		std::size_t reallocations = 0;
+		std::thread producer([&]{
+				for(std::size_t i = 0; i < 10; ++i){
+					blocks.push_back(allocator.allocate(16));
+				}
+				produced.set_value();
+				consumed_future.wait();
+
+				auto const before = allocations.load();
+				for(auto& block: blocks){
+					block = allocator.allocate(16);
+				}
+				reallocations = allocations.load() - before;
+				for(auto block: blocks){
+					allocator.deallocate(block, 16);
+				}
+			});
+
+		produced_future.wait();
+		for(auto block: blocks){
+			allocator.deallocate(block, 16);
+		}
+		consumed.set_value();
+		producer.join();
+
+		std::cout << "blocks of other threads return to their owner: "
+			<< bool_{reallocations == 0} << '\n';
+	}
+
+	try{
+		using std::make_unique;
+		webservice::server server(
+			make_unique< webservice::error_printing_request_handler<
+				webservice::http_request_handler > >(),
+			make_unique< ws_service >(),
+			make_unique< webservice::error_printing_error_handler >(),
+			boost::asio::ip::make_address("127.0.0.1"), 1234, 1);
+
+		webservice::client client(
+			make_unique< ws_client_service >(),
+			make_unique< webservice::error_handler >());
+		client.connect("127.0.0.1", "1234", "/");
+
+		server.block();
+	}catch(std::exception const& e){
+		std::cerr << "Exception: " << e.what() << "\n";
+		return 1;
+	}
+
+	auto const per_message =
+		static_cast< double >(allocations_at_end - allocations_at_start)
+		/ measured;
+	std::cout << "allocations per echoed message: " << per_message << ' '
+		<< bool_{allocations_at_end > 0 && per_message <= max_allocations}
+		<< '\n';
+}
@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/json_codec.hpp>
+#include <webservice/ws_session_settings.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <string>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Write data in parts of part_size bytes, one segment per part
+boost::beast::multi_buffer make_buffer(
+	std::string const& data,
+	std::size_t part_size
+){
+	boost::beast::multi_buffer result;
+	for(std::size_t i = 0; i < data.size(); i += part_size){
+		auto const size = std::min(part_size, data.size() - i);
+		result.commit(boost::asio::buffer_copy(
+			result.prepare(size), boost::asio::buffer(&data[i], size)));
+	}
+	return result;
+}
+
+std::size_t segment_count(boost::beast::multi_buffer const& buffer){
+	auto const data = buffer.data();
+	return static_cast< std::size_t >(std::distance(
+		boost::asio::buffer_sequence_begin(data),
+		boost::asio::buffer_sequence_end(data)));
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	constexpr webservice::from_multi_buffer_t< nlohmann::json > to_json{};
+
+	nlohmann::json message;
+	for(std::size_t i = 0; i < 200; ++i){
+		message["values"].push_back({{"id", i}, {"name", "sensor"}});
+	}
+	auto const text = message.dump();
+
+	{
+		auto const buffer = make_buffer(text, text.size());
+		std::cout << "parse contiguous: "
+			<< bool_{segment_count(buffer) == 1 && to_json(buffer) == message}
+			<< '\n';
+	}
+
+	{
+		auto const buffer = make_buffer(text, 1000);
+		std::cout << "parse segmented: "
+			<< bool_{segment_count(buffer) > 1 && to_json(buffer) == message}
+			<< '\n';
+	}
+
+	{
+		auto invalid = text;
+		invalid[text.find(',', text.size() / 2)] = '#';
+		auto const buffer = make_buffer(invalid, 1000);
+		std::string error;
+		try{
+			to_json(buffer);
+		}catch(std::exception const& e){
+			error = e.what();
+		}
+		std::cout << "error message contains a bounded excerpt: "
+			<< bool_{!error.empty() && error.size() < 400 &&
+				error.find('#') != std::string::npos} << '\n';
+	}
+
+	for(auto const codec: {
+		webservice::json_codec::json,
+		webservice::json_codec::cbor,
+		webservice::json_codec::msgpack,
+		webservice::json_codec::ubjson
+	}){
+		auto const encoded = webservice::encode_json(message, codec);
+		std::string data(encoded.size(), '\0');
+		boost::asio::buffer_copy(
+			boost::asio::buffer(&data[0], data.size()), encoded);
+
+		auto const buffer = make_buffer(data, 1000);
+		std::cout << "round trip " << webservice::to_subprotocol(codec)
+			<< ": " << bool_{
+				webservice::decode_json(buffer, codec) == message}
+			<< '\n';
+	}
+
+	{
+		webservice::ws_session_settings settings;
+		settings.set_subprotocols({"cbor", "msgpack", "json"});
+		std::cout << "select subprotocol: " << bool_{
+				settings.select_subprotocol("json, msgpack") == "msgpack" &&
+				settings.select_subprotocol("json") == "json" &&
+				settings.select_subprotocol("xml, wamp").empty() &&
+				settings.select_subprotocol("").empty()}
+			<< '\n';
+	}
+
+	{
+		webservice::json_fragment const reference(message);
+
+		webservice::spliced_json spliced;
+		spliced.value["type"] = "update";
+		spliced.value["reference"] = spliced.embed(reference);
+		spliced.value["list"] = {spliced.embed(reference), 1};
+		spliced.value["text"] = "\"\\u0000webservice_fragment:0\\u0000\"";
+
+		constexpr webservice::to_shared_const_buffer_t< nlohmann::json >
+			to_buffer{};
+		auto const buffer = to_buffer(spliced);
+
+		std::string data(buffer.size(), '\0');
+		boost::asio::buffer_copy(
+			boost::asio::buffer(&data[0], data.size()), buffer);
+
+		nlohmann::json expected;
+		expected["type"] = "update";
+		expected["reference"] = message;
+		expected["list"] = {message, 1};
+		expected["text"] = spliced.value["text"];
+
+		auto const fragment_data = reference.buffer().begin()->data();
+		std::cout << "splice fragments without copy: " << bool_{
+				nlohmann::json::parse(data) == expected &&
+				std::count_if(buffer.begin(), buffer.end(),
+					[fragment_data](boost::asio::const_buffer const& b){
+						return b.data() == fragment_data;
+					}) == 2}
+			<< '\n';
+	}
+}
@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/json_conversion.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+
+/// \brief Prevent the compiler from optimizing the buffer away
+std::size_t sink = 0;
+
+
+template < typename Fn >
+void measure(char const* name, std::size_t count, Fn&& fn){
+	auto const start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < count; ++i){
+		sink += fn().size();
+	}
+	auto const end = std::chrono::steady_clock::now();
+
+	auto const ns = std::chrono::duration< double, std::nano >(
+		end - start).count() / count;
+	std::cout << std::setw(44) << std::left << name
+		<< std::setw(10) << std::right << std::fixed
+		<< std::setprecision(1) << ns << " ns\n";
+}
+
+
+nlohmann::json make_message(std::size_t entries){
+	nlohmann::json result;
+	result["type"] = "update";
+	result["sequence"] = 123456789;
+	for(std::size_t i = 0; i < entries; ++i){
+		result["values"].push_back({
+				{"id", i},
+				{"name", "sensor_" + std::to_string(i)},
+				{"value", 0.5 * i},
+				{"valid", i % 3 != 0}
+			});
+	}
+	return result;
+}
+
+
+void run(char const* name, std::size_t entries, std::size_t count){
+	auto const message = make_message(entries);
+
+	std::cout << name << " (" << message.dump().size() << " bytes):\n";
+
+	measure("  shared_const_buffer(dump())", count, [&message]{
+			return webservice::shared_const_buffer(message.dump());
+		});
+
+	webservice::to_shared_const_buffer_t< nlohmann::json > const convert;
+	measure("  to_shared_const_buffer_t< json >", count,
+		[&message, &convert]{
+			return convert(message);
+		});
+}
+
+
+void run_spliced(std::size_t entries, std::size_t count){
+	auto const reference = make_message(entries);
+
+	nlohmann::json message;
+	message["type"] = "update";
+	message["sequence"] = 123456789;
+	message["reference"] = reference;
+
+	std::cout << "envelope with reference data ("
+		<< message.dump().size() << " bytes):\n";
+
+	webservice::to_shared_const_buffer_t< nlohmann::json > const convert;
+	measure("  to_shared_const_buffer_t< json >", count,
+		[&message, &convert]{
+			return convert(message);
+		});
+
+	webservice::json_fragment const fragment(reference);
+	measure("  spliced_json with json_fragment", count,
+		[&fragment, &convert]{
+			webservice::spliced_json spliced;
+			spliced.value["type"] = "update";
+			spliced.value["sequence"] = 123456789;
+			spliced.value["reference"] = spliced.embed(fragment);
+			return convert(spliced);
+		});
+}
+
+
+int main(){
+	run("small message", 1, 200000);
+	run("medium message", 20, 50000);
+	run("big message", 1000, 1000);
+	run_spliced(1000, 1000);
+
+	std::cout << "(" << sink << ")\n";
+}
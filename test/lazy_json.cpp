@@ -0,0 +1,172 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/json_ws_service.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Write data in parts of part_size bytes, one segment per part
+boost::beast::multi_buffer make_buffer(
+	std::string const& data,
+	std::size_t part_size
+){
+	boost::beast::multi_buffer result;
+	for(std::size_t i = 0; i < data.size(); i += part_size){
+		auto const size = std::min(part_size, data.size() - i);
+		result.commit(boost::asio::buffer_copy(
+			result.prepare(size), boost::asio::buffer(&data[i], size)));
+	}
+	return result;
+}
+
+bool is_invalid(std::string const& text){
+	try{
+		webservice::lazy_json{text};
+		return false;
+	}catch(std::runtime_error const&){
+		return true;
+	}
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	using webservice::lazy_json_type;
+
+	std::string const text = R"({
+			"type": "update",
+			"sequence": 18446744073709551615,
+			"offset": -9223372036854775808,
+			"scale": 2.5e-1,
+			"valid": true,
+			"none": null,
+			"escaped \"key\"": "tab\t \u00e4 \ud83d\ude00",
+			"values": [1, {"id": 2}, [], {}, "x"]
+		})";
+
+	constexpr webservice::from_multi_buffer_t< webservice::lazy_json >
+		to_lazy_json{};
+
+	for(auto const part_size: {text.size(), std::size_t(7)}){
+		auto const json = to_lazy_json(make_buffer(text, part_size));
+		auto const values = json.at("values");
+
+		std::cout << "access " << (part_size == text.size()
+			? "contiguous" : "segmented") << ": " << bool_{
+				json.root().size() == 8 &&
+				json.at("type").equals("update") &&
+				json.at("sequence").get_uint64() == 18446744073709551615u &&
+				json.at("offset").get_int64() ==
+					std::numeric_limits< std::int64_t >::min() &&
+				json.at("scale").get_double() == 0.25 &&
+				json.at("valid").get_bool() &&
+				json.at("none").is_null() &&
+				json.at("escaped \"key\"").get_string() ==
+					"tab\t \xc3\xa4 \xf0\x9f\x98\x80" &&
+				values.size() == 5 &&
+				values.at(1).at("id").get_int64() == 2 &&
+				values.at(2).type() == lazy_json_type::array &&
+				values.at(3).size() == 0 &&
+				values.at(4).get_string() == "x" &&
+				!json.find("missing") &&
+				!values.find("type")}
+			<< '\n';
+	}
+
+	{
+		webservice::lazy_json source{text};
+		auto const moved = std::move(source);
+		std::cout << "move keeps text: " << bool_{
+				moved.at("type").equals("update")}
+			<< '\n';
+	}
+
+	{
+		webservice::lazy_json const json{text};
+		std::cout << "materialize: " << bool_{
+				webservice::materialize(json.root()) ==
+				nlohmann::json::parse(text)}
+			<< '\n';
+	}
+
+	{
+		webservice::lazy_json const json{text};
+		std::size_t members = 0;
+		json.root().for_each_member(
+			[&members](std::string const&, webservice::lazy_json_value){
+				++members;
+			});
+		std::size_t elements = 0;
+		json.at("values").for_each_element(
+			[&elements](webservice::lazy_json_value){
+				++elements;
+			});
+		std::cout << "iterate: " << bool_{members == 8 && elements == 5}
+			<< '\n';
+	}
+
+	{
+		webservice::lazy_json const json{text};
+		bool type_error = false;
+		try{
+			json.at("type").get_int64();
+		}catch(std::runtime_error const&){
+			type_error = true;
+		}
+		bool missing = false;
+		try{
+			json.at("missing");
+		}catch(std::out_of_range const&){
+			missing = true;
+		}
+		std::cout << "access errors: " << bool_{type_error && missing}
+			<< '\n';
+	}
+
+	std::cout << "invalid rejected: " << bool_{
+			is_invalid("") &&
+			is_invalid("{") &&
+			is_invalid("[1,]") &&
+			is_invalid("{\"a\" 1}") &&
+			is_invalid("{\"a\":1,}") &&
+			is_invalid("01") &&
+			is_invalid("1.") &&
+			is_invalid("-") &&
+			is_invalid("tru") &&
+			is_invalid("\"\\x\"") &&
+			is_invalid("\"\\u12g4\"") &&
+			is_invalid("\"a\nb\"") &&
+			is_invalid("1 2") &&
+			is_invalid(std::string(1000, '['))}
+		<< '\n';
+
+	std::cout << "valid accepted: " << bool_{
+			!is_invalid(" 0 ") &&
+			!is_invalid("-0.5E+3") &&
+			!is_invalid("\"\"") &&
+			!is_invalid("[[[]]]")}
+		<< '\n';
+}
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/json_ws_service.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+
+/// \brief Prevent the compiler from optimizing the results away
+std::size_t sink = 0;
+
+
+template < typename Fn >
+void measure(char const* name, std::size_t count, Fn&& fn){
+	auto const start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < count; ++i){
+		sink += fn();
+	}
+	auto const end = std::chrono::steady_clock::now();
+
+	auto const ns = std::chrono::duration< double, std::nano >(
+		end - start).count() / count;
+	std::cout << std::setw(44) << std::left << name
+		<< std::setw(10) << std::right << std::fixed
+		<< std::setprecision(1) << ns << " ns\n";
+}
+
+
+std::string make_message(std::size_t entries){
+	nlohmann::json result;
+	result["type"] = "update";
+	result["sequence"] = 123456789;
+	for(std::size_t i = 0; i < entries; ++i){
+		result["values"].push_back({
+				{"id", i},
+				{"name", "sensor_" + std::to_string(i)},
+				{"value", 0.5 * i},
+				{"valid", i % 3 != 0}
+			});
+	}
+	result["source"] = "benchmark";
+	return result.dump();
+}
+
+boost::beast::multi_buffer make_buffer(std::string const& data){
+	boost::beast::multi_buffer result;
+	result.commit(boost::asio::buffer_copy(
+		result.prepare(data.size()), boost::asio::buffer(data)));
+	return result;
+}
+
+
+void run(std::size_t entries, std::size_t count){
+	auto const text = make_message(entries);
+
+	std::cout << text.size() << " bytes, read type, sequence and source:\n";
+
+	constexpr webservice::from_multi_buffer_t< nlohmann::json > to_json{};
+	measure("  nlohmann::json", count, [&text, &to_json]{
+			auto const json = to_json(make_buffer(text));
+			return json["type"].get< std::string >().size()
+				+ json["sequence"].get< std::size_t >()
+				+ json["source"].get< std::string >().size();
+		});
+
+	constexpr webservice::from_multi_buffer_t< webservice::lazy_json >
+		to_lazy_json{};
+	measure("  lazy_json", count, [&text, &to_lazy_json]{
+			auto const json = to_lazy_json(make_buffer(text));
+			return json.at("type").get_string().size()
+				+ json.at("sequence").get_uint64()
+				+ json.at("source").get_string().size();
+		});
+}
+
+
+int main(){
+	run(40, 20000);
+	run(80, 10000);
+	run(120, 5000);
+
+	std::cout << "(" << sink << ")\n";
+}
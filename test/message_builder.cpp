@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/message_builder.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+std::string to_string(webservice::shared_const_buffer const& buffer){
+	std::string result(buffer.size(), '\0');
+	boost::asio::buffer_copy(
+		boost::asio::buffer(&result[0], result.size()), buffer);
+	return result;
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	{
+		webservice::message_builder builder;
+		builder.append("hello");
+		builder.push_back(' ');
+		builder.append("world");
+		auto const buffer = builder.freeze();
+		std::cout << "small message: "
+			<< bool_{to_string(buffer) == "hello world" &&
+				builder.size() == 0} << '\n';
+	}
+
+	{
+		std::string expected;
+		webservice::message_builder builder;
+		for(std::size_t i = 0; i < 10000; ++i){
+			auto const part = std::to_string(i);
+			expected += part;
+			builder.append(part);
+		}
+		auto const buffer = builder.freeze();
+		std::cout << "big message with growth: "
+			<< bool_{to_string(buffer) == expected &&
+				builder.capacity() == 0} << '\n';
+	}
+
+	{
+		void const* first = nullptr;
+		{
+			webservice::message_builder builder(1000);
+			builder.append(std::string(1000, 'a'));
+			auto const buffer = builder.freeze();
+			first = buffer.begin()->data();
+		}
+
+		webservice::message_builder builder(1000);
+		builder.append(std::string(1000, 'b'));
+		auto const buffer = builder.freeze();
+		std::cout << "storage is reused after release: "
+			<< bool_{buffer.begin()->data() == first &&
+				to_string(buffer) == std::string(1000, 'b')} << '\n';
+	}
+
+	{
+		webservice::message_builder builder(100);
+		auto const data = builder.data();
+		builder.append("short");
+		auto const buffer = builder.freeze();
+		std::cout << "small message keeps storage: "
+			<< bool_{builder.data() == data &&
+				buffer.begin()->data() != data &&
+				to_string(buffer) == "short"} << '\n';
+	}
+
+	{
+		webservice::message_builder builder;
+		auto const data = builder.grow_by(64);
+		for(std::size_t i = 0; i < 64; ++i){
+			data[i] = static_cast< unsigned char >('0' + i % 10);
+		}
+		webservice::message_builder moved(std::move(builder));
+		auto const buffer = moved.freeze();
+		std::cout << "grow_by and move: "
+			<< bool_{buffer.size() == 64 && builder.data() == nullptr &&
+				to_string(buffer).substr(0, 12) == "012345678901"} << '\n';
+	}
+}
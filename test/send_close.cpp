@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include "error_printing_ws_service.hpp"
+#include "error_printing_error_handler.hpp"
+#include "error_printing_request_handler.hpp"
+
+#include <webservice/server.hpp>
+#include <webservice/ws_service.hpp>
+#include <webservice/client.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Count of sending threads per session
+constexpr std::size_t producers = 4;
+
+/// \brief Messages per sending thread
+constexpr std::size_t messages = 10;
+
+/// \brief Count of sessions
+constexpr std::size_t rounds = 50;
+
+
+/// \brief Received messages of the finished sessions
+struct events{
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector< std::size_t > received;
+
+	void closed(std::size_t count){
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			received.push_back(count);
+		}
+		cv.notify_all();
+	}
+
+	bool wait(std::size_t count){
+		std::unique_lock< std::mutex > lock(mutex);
+		return cv.wait_for(lock, std::chrono::seconds(10),
+			[this, count]{ return received.size() >= count; });
+	}
+} events;
+
+
+/// \brief Sends from several threads, the last one closes the session
+struct ws_service
+	: webservice::error_printing_ws_service< webservice::ws_service >
+{
+	void on_open(webservice::ws_identifier identifier)override{
+		auto const done = std::make_shared< std::atomic< std::size_t > >(0);
+		for(std::size_t i = 0; i < producers; ++i){
+			std::thread([this, identifier, done, i]{
+					for(std::size_t j = 0; j < messages; ++j){
+						send_text(identifier,
+							std::to_string(i) + ":" + std::to_string(j));
+					}
+
+					// Every message was sent before the close
+					if(done->fetch_add(1) + 1 == producers){
+						close(identifier, "done");
+					}
+				}).detach();
+		}
+	}
+};
+
+
+/// \brief Counts the messages of its session
+struct ws_client_service
+	: webservice::error_printing_ws_service< webservice::ws_service >
+{
+	std::size_t count = 0;
+
+	void on_text(webservice::ws_identifier, std::string&&)override{
+		++count;
+	}
+
+	void on_close(webservice::ws_identifier)override{
+		events.closed(std::exchange(count, 0));
+	}
+};
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	try{
+		using std::make_unique;
+		webservice::server server(
+			make_unique< webservice::error_printing_request_handler<
+				webservice::http_request_handler > >(),
+			make_unique< ws_service >(),
+			make_unique< webservice::error_printing_error_handler >(),
+			boost::asio::ip::make_address("127.0.0.1"), 1234, 4);
+
+		webservice::client client(
+			make_unique< ws_client_service >(),
+			make_unique< webservice::error_printing_error_handler >());
+
+		bool all_closed = true;
+		for(std::size_t i = 0; i < rounds; ++i){
+			client.connect("127.0.0.1", "1234", "/");
+			all_closed = events.wait(i + 1) && all_closed;
+		}
+
+		bool complete = true;
+		{
+			std::lock_guard< std::mutex > lock(events.mutex);
+			for(auto const count: events.received){
+				complete = complete && count == producers * messages;
+			}
+		}
+		std::cout << "messages before close are sent: "
+			<< bool_{all_closed && complete} << '\n';
+
+		server.shutdown();
+		client.shutdown();
+		server.block();
+		client.block();
+
+		return 0;
+	}catch(std::exception const& e){
+		std::cerr << "Exception: " << e.what() << "\n";
+		return 1;
+	}catch(...){
+		std::cerr << "Unknown exception\n";
+		return 1;
+	}
+}
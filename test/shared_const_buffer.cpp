@@ -8,11 +8,18 @@
 //-----------------------------------------------------------------------------
 #include <webservice/shared_const_buffer.hpp>
 
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
 #include <iostream>
 #include <iomanip>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <iterator>
 
 struct bool_{ bool v; };
 
@@ -163,4 +170,151 @@ int main(){
 				static_cast< char const* >(buffer.begin()->data())
 					+ buffer.begin()->size())} << '\n';
 	}
+
+	{
+		std::string data("12345");
+		webservice::shared_const_buffer buffer(data);
+		webservice::shared_const_buffer copy(buffer);
+		auto const ptr = buffer.begin()->data();
+		webservice::shared_const_buffer moved(std::move(buffer));
+		std::cout << "small string, copy and move keep storage: "
+			<< bool_{copy.begin()->data() == ptr &&
+				moved.begin()->data() == ptr && ptr != data.data() &&
+				std::equal(data.begin(), data.end(),
+					static_cast< char const* >(copy.begin()->data()),
+					static_cast< char const* >(copy.begin()->data())
+						+ copy.begin()->size()) &&
+				std::equal(data.begin(), data.end(),
+					static_cast< char const* >(moved.begin()->data()),
+					static_cast< char const* >(moved.begin()->data())
+						+ moved.begin()->size())} << '\n';
+	}
+
+	{
+		std::string data(1000, 'x');
+		webservice::shared_const_buffer buffer(data);
+		webservice::shared_const_buffer copy(buffer);
+		auto const ptr = buffer.begin()->data();
+		webservice::shared_const_buffer moved(std::move(buffer));
+		copy = moved;
+		std::cout << "big string, copy shares storage: "
+			<< bool_{copy.begin()->data() == ptr &&
+				moved.begin()->data() == ptr &&
+				buffer.begin()->size() == 0 &&
+				std::equal(data.begin(), data.end(),
+					static_cast< char const* >(copy.begin()->data()),
+					static_cast< char const* >(copy.begin()->data())
+						+ copy.begin()->size())} << '\n';
+	}
+
+	{
+		std::string data(1000, 'x');
+		webservice::shared_const_buffer small(std::string("12345"));
+		webservice::shared_const_buffer big(data);
+		small = big;
+		big = webservice::shared_const_buffer(std::string("abc"));
+		std::cout << "assign between small and big: "
+			<< bool_{small.begin()->size() == data.size() &&
+				big.begin()->size() == 3 &&
+				static_cast< char const* >(big.begin()->data())[2] == 'c'}
+			<< '\n';
+	}
+
+	{
+		webservice::shared_const_buffer header(std::string("head:"));
+		webservice::shared_const_buffer body(std::string(100, 'b'));
+		webservice::shared_const_buffer message{header, body,
+			webservice::shared_const_buffer(std::string("!"))};
+		webservice::shared_const_buffer copy(message);
+		message = webservice::shared_const_buffer(std::string("x"));
+
+		std::string expected = "head:" + std::string(100, 'b') + "!";
+		std::string result(copy.size(), '\0');
+		boost::asio::buffer_copy(boost::asio::buffer(&result[0],
+			result.size()), copy);
+		std::cout << "segments: "
+			<< bool_{copy.segment_count() == 3 &&
+				std::next(copy.begin(), 1)->data() == body.begin()->data() &&
+				result == expected} << '\n';
+	}
+
+	{
+		webservice::shared_const_buffer inner{
+			webservice::shared_const_buffer(std::string("ab")),
+			webservice::shared_const_buffer(std::string("cd"))};
+		webservice::shared_const_buffer outer{inner,
+			webservice::shared_const_buffer(std::string("ef"))};
+
+		std::string result(outer.size(), '\0');
+		boost::asio::buffer_copy(boost::asio::buffer(&result[0],
+			result.size()), outer);
+		std::cout << "nested segments: "
+			<< bool_{outer.segment_count() == 3 && result == "abcdef"}
+			<< '\n';
+	}
+
+	{
+		std::string const text = std::string(50, 'a') + std::string(50, 'b');
+		webservice::shared_const_buffer const buffer(text);
+		auto const big = buffer.slice(10, 80);
+		auto const small = buffer.slice(45, 10);
+
+		std::string result(big.size(), '\0');
+		boost::asio::buffer_copy(boost::asio::buffer(&result[0],
+			result.size()), big);
+		std::string small_result(small.size(), '\0');
+		boost::asio::buffer_copy(boost::asio::buffer(&small_result[0],
+			small_result.size()), small);
+
+		bool out_of_range = false;
+		try{
+			buffer.slice(90, 11);
+		}catch(std::out_of_range const&){
+			out_of_range = true;
+		}
+
+		std::cout << "slice: "
+			<< bool_{result == text.substr(10, 80) &&
+				big.begin()->data() ==
+					static_cast< char const* >(buffer.begin()->data()) + 10 &&
+				small_result == "aaaaabbbbb" && out_of_range} << '\n';
+	}
+
+	{
+		// The write operation is moved while it waits for the socket, the
+		// data of a small buffer must not move with it
+		boost::asio::io_context ioc;
+		boost::asio::local::stream_protocol::socket writer(ioc);
+		boost::asio::local::stream_protocol::socket reader(ioc);
+		boost::asio::local::connect_pair(writer, reader);
+
+		writer.non_blocking(true);
+		std::vector< char > const fill(4096, '-');
+		std::size_t filled = 0;
+		boost::system::error_code ec;
+		while(!ec){
+			filled += writer.write_some(boost::asio::buffer(fill), ec);
+		}
+
+		std::string const text("0123456789abcdefghijklmnopqrstu");
+		boost::system::error_code write_ec;
+		boost::asio::async_write(writer, webservice::shared_const_buffer(text),
+			[&write_ec](boost::system::error_code ec, std::size_t){
+				write_ec = ec;
+			});
+
+		std::string received(filled + text.size(), '\0');
+		boost::system::error_code read_ec;
+		boost::asio::async_read(reader,
+			boost::asio::buffer(&received[0], received.size()),
+			[&read_ec](boost::system::error_code ec, std::size_t){
+				read_ec = ec;
+			});
+		ioc.run();
+
+		std::cout << "small buffer on full socket: "
+			<< bool_{ec == boost::asio::error::would_block &&
+				!write_ec && !read_ec && text.size() == 31 &&
+				received.compare(filled, text.size(), text) == 0} << '\n';
+	}
 }
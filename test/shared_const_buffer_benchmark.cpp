@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/shared_const_buffer.hpp>
+
+#include <boost/any.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+/// \brief The former boost::any based implementation for comparison
+class any_const_buffer{
+public:
+	template < typename T >
+	explicit any_const_buffer(T&& data)
+		: any_const_buffer(
+			std::make_shared< typename std::decay< T >::type const >(
+				static_cast< T&& >(data))) {}
+
+	template < typename T >
+	explicit any_const_buffer(std::shared_ptr< T > data)
+		: data_(std::move(data))
+		, buffer_(boost::asio::buffer(
+			*boost::any_cast< std::shared_ptr< T > >(data_))) {}
+
+	boost::asio::const_buffer const* begin()const{
+		return &buffer_;
+	}
+
+private:
+	boost::any data_;
+	boost::asio::const_buffer buffer_;
+};
+
+
+/// \brief Prevent the compiler from optimizing the buffer away
+std::size_t sink = 0;
+
+template < typename Buffer >
+void consume(Buffer const& buffer){
+	sink += buffer.begin()->size();
+}
+
+
+template < typename Fn >
+void measure(char const* name, std::size_t count, Fn&& fn){
+	auto const start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < count; ++i){
+		fn();
+	}
+	auto const end = std::chrono::steady_clock::now();
+
+	auto const ns = std::chrono::duration< double, std::nano >(
+		end - start).count() / count;
+	std::cout << std::setw(44) << std::left << name
+		<< std::setw(10) << std::right << std::fixed
+		<< std::setprecision(1) << ns << " ns\n";
+}
+
+
+template < typename Buffer >
+void run(char const* name){
+	constexpr std::size_t count = 1000000;
+
+	std::string const small(20, 'x');
+	std::string const big(1000, 'x');
+
+	std::cout << name << ":\n";
+
+	measure("  construct from small string", count, [&small]{
+			Buffer buffer{std::string(small)};
+			consume(buffer);
+		});
+
+	measure("  construct from big string", count, [&big]{
+			Buffer buffer{std::string(big)};
+			consume(buffer);
+		});
+
+	Buffer const small_buffer(small);
+	measure("  copy with small data", count, [&small_buffer]{
+			Buffer copy(small_buffer);
+			consume(copy);
+		});
+
+	Buffer const big_buffer(big);
+	measure("  copy with big data", count, [&big_buffer]{
+			Buffer copy(big_buffer);
+			consume(copy);
+		});
+
+	std::vector< Buffer > list;
+	list.reserve(16);
+	measure("  16 copies into a vector", count / 16, [&big_buffer, &list]{
+			list.clear();
+			for(std::size_t i = 0; i < 16; ++i){
+				list.push_back(big_buffer);
+			}
+			consume(list.back());
+		});
+}
+
+
+int main(){
+	run< any_const_buffer >("boost::any + shared_ptr");
+	run< webservice::shared_const_buffer >("shared_const_buffer");
+
+	std::cout << "(" << sink << ")\n";
+}
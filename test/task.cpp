@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/task.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+/// \brief Stores the handle of the waiting coroutine for a manual resume
+struct manual_event{
+	struct awaiter{
+		bool await_ready()const noexcept{ return false; }
+
+		void await_suspend(std::coroutine_handle<> handle)noexcept{
+			event.waiter = handle;
+		}
+
+		void await_resume()const noexcept{}
+
+		manual_event& event;
+	};
+
+	awaiter wait()noexcept{
+		return {*this};
+	}
+
+	void resume(){
+		std::exchange(waiter, nullptr).resume();
+	}
+
+	std::coroutine_handle<> waiter;
+};
+
+
+webservice::task< int > square(int value){
+	co_return value * value;
+}
+
+webservice::task< int > sum_of_squares(int a, int b){
+	co_return co_await square(a) + co_await square(b);
+}
+
+webservice::task<> fail(){
+	throw std::runtime_error("fail");
+	co_return;
+}
+
+webservice::task< void* > frame_address(){
+	int local = 0;
+	co_return &local;
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	{
+		int result = 0;
+		auto body = [&result]()->webservice::detached_task{
+				result = co_await sum_of_squares(3, 4);
+			};
+		auto run = body();
+		run.start(nullptr, nullptr);
+		std::cout << "task result: " << bool_{result == 25} << '\n';
+	}
+
+	{
+		bool caught = false;
+		auto body = [&caught]()->webservice::detached_task{
+				try{
+					co_await fail();
+				}catch(std::runtime_error const&){
+					caught = true;
+				}
+			};
+		auto run = body();
+		run.start(nullptr, nullptr);
+		std::cout << "task exception: " << bool_{caught} << '\n';
+	}
+
+	{
+		std::exception_ptr error;
+		auto body = []()->webservice::detached_task{
+				co_await fail();
+			};
+		auto run = body();
+		run.start(nullptr, [&error](std::exception_ptr e)noexcept{
+				error = e;
+			});
+		std::cout << "detached exception: " << bool_{error != nullptr}
+			<< '\n';
+	}
+
+	{
+		// Tasks called per message reuse their frames
+		manual_event event;
+		std::set< void* > frames;
+		bool done = false;
+		auto body = [&]()->webservice::detached_task{
+				for(int i = 0; i < 10; ++i){
+					co_await event.wait();
+					frames.insert(co_await frame_address());
+				}
+				done = true;
+			};
+		auto run = body();
+		run.start(nullptr, nullptr);
+		while(!done){
+			event.resume();
+		}
+		std::cout << "frames recycled: " << bool_{frames.size() == 1} << '\n';
+	}
+
+	{
+		auto owner = std::make_shared< int >(0);
+		std::weak_ptr< int > watch = owner;
+		boost::asio::io_context ioc;
+		std::thread::id thread;
+		auto body = [&]()->webservice::detached_task{
+				co_await webservice::resume_on(ioc);
+				thread = std::this_thread::get_id();
+			};
+		auto run = body();
+		run.start(std::move(owner), nullptr);
+		bool const waiting = !watch.expired();
+		std::thread worker([&ioc]{ ioc.run(); });
+		auto const worker_id = worker.get_id();
+		worker.join();
+		std::cout << "resume on: "
+			<< bool_{waiting && thread == worker_id && watch.expired()}
+			<< '\n';
+	}
+}
@@ -0,0 +1,261 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include "error_printing_ws_service.hpp"
+#include "error_printing_error_handler.hpp"
+#include "error_printing_request_handler.hpp"
+
+#include <webservice/server.hpp>
+#include <webservice/ws_service.hpp>
+#include <webservice/client.hpp>
+
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+struct user{
+	std::string name;
+};
+
+namespace webservice{
+
+	template <>
+	struct ws_session_key_t< user >{
+		boost::optional< std::string > operator()(user const& value)const{
+			if(value.name.empty()){
+				return boost::none;
+			}
+			return value.name;
+		}
+	};
+
+}
+
+
+/// \brief State shared by the server handlers and the test
+struct events{
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector< webservice::ws_identifier > open;
+	std::size_t closed = 0;
+	std::size_t duplicates = 0;
+	std::vector< std::pair< webservice::ws_identifier, std::string > >
+		received;
+
+	template < typename Fn >
+	void update(Fn&& fn){
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			fn();
+		}
+		cv.notify_all();
+	}
+
+	template < typename Pred >
+	bool wait(Pred&& pred){
+		std::unique_lock< std::mutex > lock(mutex);
+		return cv.wait_for(lock, std::chrono::seconds(10), pred);
+	}
+} events;
+
+
+struct ws_service
+	: webservice::basic_ws_service< user, std::string >
+{
+	void on_server_connect(
+		boost::asio::ip::tcp::socket&& socket,
+		webservice::http_request&& req
+	)override{
+		async_server_connect(std::move(socket), std::move(req));
+	}
+
+	void on_open(webservice::ws_identifier identifier)override{
+		events.update([identifier]{ events.open.push_back(identifier); });
+	}
+
+	void on_close(webservice::ws_identifier)override{
+		events.update([]{ ++events.closed; });
+	}
+
+	void on_text(
+		webservice::ws_identifier identifier,
+		std::string&& text
+	)override{
+		// Change the key from the handler, the session is reindexed before
+		// the event is visible to the test
+		if(text.compare(0, 7, "rename:") == 0){
+			with_value(identifier, [&](user& value){
+					value.name = text.substr(7);
+				});
+		}
+
+		events.update([&]{
+				events.received.emplace_back(identifier, std::move(text));
+			});
+	}
+
+	void on_exception(std::exception_ptr error)noexcept override{
+		try{
+			std::rethrow_exception(error);
+		}catch(std::logic_error const& e){
+			if(std::string(e.what()) == "session key already in use"){
+				events.update([]{ ++events.duplicates; });
+				return;
+			}
+			std::cout << "\033[1;31mfail ws_service: unexpected exception: "
+				<< e.what() << "\033[0m\n";
+		}catch(std::exception const& e){
+			std::cout << "\033[1;31mfail ws_service: unexpected exception: "
+				<< e.what() << "\033[0m\n";
+		}catch(...){
+			std::cout << "\033[1;31mfail ws_service: unexpected unknown "
+				"exception\033[0m\n";
+		}
+	}
+
+	void on_exception(
+		webservice::ws_identifier,
+		std::exception_ptr error
+	)noexcept override{
+		on_exception(error);
+	}
+};
+
+
+/// \brief Echoes every text message
+struct ws_client_service
+	: webservice::error_printing_ws_service< webservice::ws_service >
+{
+	void on_text(
+		webservice::ws_identifier identifier,
+		std::string&& text
+	)override{
+		send_text(identifier, std::move(text));
+	}
+};
+
+
+struct request_handler
+	: webservice::error_printing_request_handler<
+		webservice::http_request_handler >
+{
+	using error_printing_request_handler::error_printing_request_handler;
+};
+
+
+/// \brief Wait until text was echoed, true if it came from identifier and
+///        nothing else was received before
+bool echoed_only(webservice::ws_identifier identifier, std::string text){
+	if(!events.wait([]{ return !events.received.empty(); })){
+		return false;
+	}
+
+	std::lock_guard< std::mutex > lock(events.mutex);
+	auto const received = std::move(events.received);
+	events.received.clear();
+	return received.size() == 1
+		&& received[0].first == identifier
+		&& received[0].second == text;
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	try{
+		using std::make_unique;
+		auto service = make_unique< ws_service >();
+		auto& keyed = *service;
+		webservice::server server(
+			make_unique< request_handler >(),
+			std::move(service),
+			make_unique< webservice::error_printing_error_handler >(),
+			boost::asio::ip::make_address("127.0.0.1"), 1234, 1);
+
+		webservice::client client(
+			make_unique< ws_client_service >(),
+			make_unique< webservice::error_printing_error_handler >());
+
+		client.connect("127.0.0.1", "1234", "/");
+		events.wait([]{ return events.open.size() == 1; });
+		client.connect("127.0.0.1", "1234", "/");
+		std::cout << "sessions open: "
+			<< bool_{events.wait([]{ return events.open.size() == 2; })}
+			<< '\n';
+
+		auto const a = events.open[0];
+		auto const b = events.open[1];
+
+		// The index follows the value, all calls run in order on the strand
+		keyed.set_value(a, user{"alice"});
+		keyed.send_text_to_key("alice", "insert");
+		std::cout << "insert: " << bool_{echoed_only(a, "insert")} << '\n';
+
+		keyed.set_value(b, user{"alice"});
+		keyed.send_text_to_key("alice", "duplicate");
+		std::cout << "duplicate key: "
+			<< bool_{echoed_only(a, "duplicate") && events.duplicates == 1}
+			<< '\n';
+
+		keyed.modify_value(a, [](user& value){ value.name = "bob"; });
+		keyed.send_text_to_key("alice", "old key");
+		keyed.send_text_to_key("bob", "new key");
+		std::cout << "re-key: " << bool_{echoed_only(a, "new key")} << '\n';
+
+		keyed.set_value(b, user{"alice"});
+		keyed.send_text_to_key("alice", "free key");
+		std::cout << "freed key: "
+			<< bool_{echoed_only(b, "free key")} << '\n';
+
+		keyed.send_text(b, "rename:carol");
+		auto const renamed = echoed_only(b, "rename:carol");
+		keyed.send_text_to_key("alice", "old handler key");
+		keyed.send_text_to_key("carol", "handler key");
+		std::cout << "re-key in handler: "
+			<< bool_{renamed && echoed_only(b, "handler key")} << '\n';
+
+		keyed.close_key("bob", "bye");
+		auto const closed = events.wait([]{ return events.closed == 1; });
+		keyed.send_text_to_key("bob", "closed");
+		keyed.set_value(b, user{"bob"});
+		keyed.send_text_to_key("bob", "reused key");
+		std::cout << "erase on close: "
+			<< bool_{closed && echoed_only(b, "reused key")
+				&& events.duplicates == 1} << '\n';
+
+		server.shutdown();
+		client.shutdown();
+		server.block();
+		client.block();
+
+		return 0;
+	}catch(std::exception const& e){
+		std::cerr << "Exception: " << e.what() << "\n";
+		return 1;
+	}catch(...){
+		std::cerr << "Unknown exception\n";
+		return 1;
+	}
+}
@@ -0,0 +1,122 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2018 Benjamin Buch
+//
+// https://github.com/bebuch/http
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+//-----------------------------------------------------------------------------
+#include <webservice/ws_tag_index.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+
+struct bool_{ bool v; };
+
+std::ostream& operator<<(std::ostream& os, bool_ v){
+	if(v.v){
+		os << "\033[1;32m";
+	}else{
+		os << "\033[1;31m";
+	}
+	os.operator<<(v.v);
+	os << "\033[0m";
+	return os;
+}
+
+
+using webservice::tag_match;
+using webservice::tag_filter;
+using webservice::ws_tag_index;
+
+
+std::uint64_t reference(
+	std::vector< std::uint64_t > const& tags,
+	tag_filter filter
+){
+	std::uint64_t result = 0;
+	for(std::size_t i = 0; i < tags.size(); ++i){
+		auto const masked = tags[i] & filter.mask;
+		bool const hit =
+			filter.mode == tag_match::any ? masked != 0 :
+			filter.mode == tag_match::all ? masked == filter.mask :
+			masked == 0;
+		result |= std::uint64_t(hit) << i;
+	}
+	return result;
+}
+
+bool check_all_counts(tag_filter filter){
+	std::vector< std::uint64_t > tags;
+	for(std::size_t i = 0; i < 64; ++i){
+		tags.push_back((i * 0x9E3779B97F4A7C15ull) ^ (i << 3));
+	}
+
+	// odd counts exercise the scalar tail after the vector loop
+	for(std::size_t count = 0; count <= 64; ++count){
+		std::vector< std::uint64_t > part(tags.begin(), tags.begin() + count);
+		if(
+			ws_tag_index::match(part.data(), count, filter) !=
+			reference(part, filter)
+		){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int main(){
+	std::cout << std::boolalpha;
+
+	std::uint64_t const mask = 0x00F0'0000'0000'0005ull;
+
+	std::cout << "match any: "
+		<< bool_{check_all_counts({mask, tag_match::any})} << '\n';
+
+	std::cout << "match all: "
+		<< bool_{check_all_counts({mask, tag_match::all})} << '\n';
+
+	std::cout << "match none: "
+		<< bool_{check_all_counts({mask, tag_match::none})} << '\n';
+
+	std::cout << "empty mask, any matches nothing: "
+		<< bool_{check_all_counts({0, tag_match::any})} << '\n';
+
+	{
+		// The sessions are never dereferenced, only their address is used
+		std::array< char, 5 > storage{};
+		auto session = [&storage](std::size_t i)->webservice::ws_session&{
+				return *reinterpret_cast< webservice::ws_session* >(
+					&storage[i]);
+			};
+
+		ws_tag_index index;
+		std::array< std::size_t, 5 > slots{};
+		for(std::size_t i = 0; i < slots.size(); ++i){
+			index.insert(session(i), i, slots[i]);
+		}
+
+		index.erase(slots[1]);
+		index.erase(slots[3]);
+
+		std::vector< webservice::ws_session* > found;
+		index.for_each_match({~std::uint64_t(0), tag_match::none},
+			[&found](webservice::ws_session& s){ found.push_back(&s); });
+
+		bool const slots_valid =
+			index.size() == 3 &&
+			index.get(slots[0]) == 0 &&
+			index.get(slots[2]) == 2 &&
+			index.get(slots[4]) == 4;
+		bool const found_zero =
+			found.size() == 1 && found[0] == &session(0);
+
+		std::cout << "slots after erase: " << bool_{slots_valid} << '\n';
+		std::cout << "for_each_match after erase: "
+			<< bool_{found_zero} << '\n';
+	}
+}